@@ -0,0 +1,117 @@
+"""Generates raw (uncompressed) font headers from the stb-compressed ones under Embeded/fonts.
+
+Used by the 'heimgui-raw-fonts' premake option: the fonts are then embedded as aligned read-only
+TTF bytes that ImGui reads in place, with no inflate and no heap copy at startup.
+
+    python embed_raw_fonts.py <Embeded/fonts directory>
+
+Writes <dir>/raw/<font>.h, skipping headers that are already newer than their source.
+"""
+
+import os
+import re
+import sys
+
+FONTS = ["OpenSans-Regular", "OpenSans-Bold", "fa-regular-400", "fa-solid-900"]
+
+
+def read_compressed(path):
+    with open(path, "r", encoding="utf-8") as f:
+        text = f.read()
+
+    match = re.search(r"_compressed_data\[\d+\]\s*=\s*\{(.*?)\};", text, re.S)
+    if not match:
+        raise ValueError(f"{path}: no compressed array found")
+
+    return bytes(int(v) for v in match.group(1).replace("\n", "").split(",") if v.strip())
+
+
+def stb_decompress(data):
+    """Decoder for stb_compress streams, as in imgui_draw.cpp."""
+
+    def in2(i): return (data[i] << 8) + data[i + 1]
+    def in3(i): return (data[i] << 16) + in2(i + 1)
+    def in4(i): return (data[i] << 24) + in3(i + 1)
+
+    if in4(0) != 0x57BC0000 or in4(4) != 0:
+        raise ValueError("not an stb_compress stream")
+
+    size = in4(8)
+    out = bytearray()
+
+    def match(dist, length):
+        start = len(out) - dist
+        if start < 0:
+            raise ValueError("corrupt stream")
+        for k in range(length):  # overlapping copies repeat the pattern
+            out.append(out[start + k])
+
+    i = 16
+    while True:
+        c = data[i]
+        if c >= 0x80:   match(data[i + 1] + 1, c - 0x80 + 1); i += 2
+        elif c >= 0x40: match(in2(i) - 0x4000 + 1, data[i + 2] + 1); i += 3
+        elif c >= 0x20: n = c - 0x20 + 1; out += data[i + 1:i + 1 + n]; i += 1 + n
+        elif c >= 0x18: match(in3(i) - 0x180000 + 1, data[i + 3] + 1); i += 4
+        elif c >= 0x10: match(in3(i) - 0x100000 + 1, in2(i + 3) + 1); i += 5
+        elif c >= 0x08: n = in2(i) - 0x0800 + 1; out += data[i + 2:i + 2 + n]; i += 2 + n
+        elif c == 0x07: n = in2(i + 1) + 1; out += data[i + 3:i + 3 + n]; i += 3 + n
+        elif c == 0x06: match(in3(i + 1) + 1, data[i + 4] + 1); i += 5
+        elif c == 0x04: match(in3(i + 1) + 1, in2(i + 4) + 1); i += 6
+        elif c == 0x05 and data[i + 1] == 0xFA: break
+        else: raise ValueError("corrupt stream")
+
+    if len(out) != size:
+        raise ValueError("size mismatch")
+
+    s1, s2 = 1, 0
+    for b in out:
+        s1 = (s1 + b) % 65521
+        s2 = (s2 + s1) % 65521
+    if (s2 << 16) + s1 != in4(i + 2):
+        raise ValueError("checksum mismatch")
+
+    return bytes(out)
+
+
+def write_raw(path, font, ttf, generator="embed_raw_fonts.py"):
+    symbol = font.replace("-", "_")
+    lines = [
+        f"// File: '{font}.ttf' ({len(ttf)} bytes)",
+        f"// Generated by Scripts/{generator}, do not edit",
+        f"static const unsigned int {symbol}_size = {len(ttf)};",
+        f"alignas(16) static const unsigned char {symbol}_data[{len(ttf)}] =",
+        "{",
+    ]
+    for offset in range(0, len(ttf), 64):
+        lines.append("    " + ",".join(str(b) for b in ttf[offset:offset + 64]) + ",")
+    lines.append("};")
+
+    with open(path, "w", encoding="utf-8", newline="\n") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def main():
+    if len(sys.argv) != 2:
+        print(__doc__)
+        return 1
+
+    fonts_dir = sys.argv[1]
+    raw_dir = os.path.join(fonts_dir, "raw")
+    os.makedirs(raw_dir, exist_ok=True)
+
+    for font in FONTS:
+        src = os.path.join(fonts_dir, font + ".h")
+        dst = os.path.join(raw_dir, font + ".h")
+
+        if os.path.exists(dst) and os.path.getmtime(dst) >= os.path.getmtime(src):
+            continue
+
+        write_raw(dst, font, stb_decompress(read_compressed(src)))
+        print(f"embed_raw_fonts: {dst}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
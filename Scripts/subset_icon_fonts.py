@@ -0,0 +1,130 @@
+"""Subsets the embedded Font Awesome fonts to the icons an application uses.
+
+Used by the 'heimgui-icon-manifest' premake option. The manifest lists codepoints, one entry per line:
+
+    f015            # house
+    0xf07b          # folder
+    U+F0C7          # floppy disk
+    f100-f103       # angle double left .. down
+    # comments and blank lines are ignored
+
+    python subset_icon_fonts.py <manifest> <Embeded/fonts directory>
+
+Writes <dir>/subset/<font>.h with the subset TTFs as raw aligned arrays (small enough not to need compression)
+and <dir>/subset/icon_ranges.h with the matching ImGui glyph ranges. Needs fontTools (pip install fonttools).
+"""
+
+import io
+import os
+import sys
+
+from fontTools import subset
+from fontTools.ttLib import TTFont
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from embed_raw_fonts import read_compressed, stb_decompress, write_raw  # noqa: E402
+
+ICON_FONTS = ["fa-regular-400", "fa-solid-900"]
+
+
+def parse_codepoint(text):
+    text = text.strip().lower()
+    for prefix in ("u+", "0x"):
+        if text.startswith(prefix):
+            text = text[len(prefix):]
+    return int(text, 16)
+
+
+def read_manifest(path):
+    codepoints = set()
+    with open(path, "r", encoding="utf-8") as f:
+        for number, line in enumerate(f, 1):
+            line = line.split("#", 1)[0].strip()
+            if not line:
+                continue
+            try:
+                if "-" in line:
+                    first, last = (parse_codepoint(v) for v in line.split("-", 1))
+                    codepoints.update(range(first, last + 1))
+                else:
+                    codepoints.add(parse_codepoint(line))
+            except ValueError:
+                raise ValueError(f"{path}:{number}: not a codepoint: '{line}'")
+
+    if not codepoints:
+        raise ValueError(f"{path}: no codepoints, every icon would be dropped")
+
+    if max(codepoints) > 0xFFFF:
+        raise ValueError(f"{path}: codepoints above U+FFFF need IMGUI_USE_WCHAR32")
+
+    return sorted(codepoints)
+
+
+def subset_font(ttf, codepoints):
+    options = subset.Options()
+    options.hinting = False
+    options.layout_features = []
+    options.name_IDs = []
+    options.notdef_outline = True
+    options.drop_tables += ["FFTM"]
+
+    font = TTFont(io.BytesIO(ttf))
+    subsetter = subset.Subsetter(options)
+    subsetter.populate(unicodes=codepoints)
+    subsetter.subset(font)
+
+    out = io.BytesIO()
+    font.save(out)
+    return out.getvalue()
+
+
+def write_ranges(path, codepoints):
+    ranges = []
+    for cp in codepoints:
+        if ranges and ranges[-1][1] + 1 == cp:
+            ranges[-1][1] = cp
+        else:
+            ranges.append([cp, cp])
+
+    lines = [
+        "// Generated by Scripts/subset_icon_fonts.py, do not edit",
+        f"// {len(codepoints)} icons in {len(ranges)} ranges",
+        "static const ImWchar c_IconGlyphRanges[] =",
+        "{",
+    ]
+    lines += [f"    0x{first:04x}, 0x{last:04x}," for first, last in ranges]
+    lines += ["    0,", "};"]
+
+    with open(path, "w", encoding="utf-8", newline="\n") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__)
+        return 1
+
+    manifest, fonts_dir = sys.argv[1], sys.argv[2]
+    subset_dir = os.path.join(fonts_dir, "subset")
+    os.makedirs(subset_dir, exist_ok=True)
+
+    ranges_path = os.path.join(subset_dir, "icon_ranges.h")
+    inputs = [manifest, os.path.abspath(__file__)] + [os.path.join(fonts_dir, font + ".h") for font in ICON_FONTS]
+    if os.path.exists(ranges_path) and os.path.getmtime(ranges_path) >= max(os.path.getmtime(p) for p in inputs):
+        return 0
+
+    codepoints = read_manifest(manifest)
+
+    for font in ICON_FONTS:
+        ttf = stb_decompress(read_compressed(os.path.join(fonts_dir, font + ".h")))
+        subsetted = subset_font(ttf, codepoints)
+        write_raw(os.path.join(subset_dir, font + ".h"), font, subsetted, "subset_icon_fonts.py")
+        print(f"subset_icon_fonts: {font} {len(ttf)} -> {len(subsetted)} bytes")
+
+    # written last, its timestamp marks the whole set as up to date
+    write_ranges(ranges_path, codepoints)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
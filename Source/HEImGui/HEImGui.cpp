@@ -1,42 +1,185 @@
 #include "Core/Core.h"
+#include "HEImGui.h"
 #include <format>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include <imgui_internal.h>
 #include <ImExtensions/ImGuizmo.h>
 #include <backends/imgui_impl_glfw.cpp>
 
-#include "Embeded/fonts/fa-regular-400.h"
-#include "Embeded/fonts/fa-solid-900.h"
+#ifdef HE_IMGUI_RAW_FONTS
+#include "Embeded/fonts/raw/OpenSans-Bold.h"
+#include "Embeded/fonts/raw/OpenSans-Regular.h"
+#else
 #include "Embeded/fonts/OpenSans-Bold.h"
 #include "Embeded/fonts/OpenSans-Regular.h"
+#endif
+
+#if defined(HE_IMGUI_ICON_SUBSET)
+#include "Embeded/fonts/subset/fa-regular-400.h"
+#include "Embeded/fonts/subset/fa-solid-900.h"
+#include "Embeded/fonts/subset/icon_ranges.h"
+#elif defined(HE_IMGUI_RAW_FONTS)
+#include "Embeded/fonts/raw/fa-regular-400.h"
+#include "Embeded/fonts/raw/fa-solid-900.h"
+#else
+#include "Embeded/fonts/fa-regular-400.h"
+#include "Embeded/fonts/fa-solid-900.h"
+#endif
 
 #if NVRHI_HAS_D3D11
 #include "Embeded/dxbc/imgui_main_vs.bin.h"
 #include "Embeded/dxbc/imgui_main_ps.bin.h"
+#include "Embeded/dxbc/imgui_main_ps_alpha8.bin.h"
+#include "Embeded/dxbc/imgui_main_ps_bindless.bin.h"
+#include "Embeded/dxbc/imgui_composite_vs.bin.h"
+#include "Embeded/dxbc/imgui_composite_ps.bin.h"
+#include "Embeded/dxbc/imgui_composite_clear_ps.bin.h"
 #endif
 
 #if NVRHI_HAS_D3D12
 #include "Embeded/dxil/imgui_main_vs.bin.h"
 #include "Embeded/dxil/imgui_main_ps.bin.h"
+#include "Embeded/dxil/imgui_main_ps_alpha8.bin.h"
+#include "Embeded/dxil/imgui_main_ps_bindless.bin.h"
+#include "Embeded/dxil/imgui_composite_vs.bin.h"
+#include "Embeded/dxil/imgui_composite_ps.bin.h"
+#include "Embeded/dxil/imgui_composite_clear_ps.bin.h"
 #endif
 
 #if NVRHI_HAS_VULKAN
 #include "Embeded/spirv/imgui_main_vs.bin.h"
 #include "Embeded/spirv/imgui_main_ps.bin.h"
+#include "Embeded/spirv/imgui_main_ps_alpha8.bin.h"
+#include "Embeded/spirv/imgui_main_ps_bindless.bin.h"
+#include "Embeded/spirv/imgui_composite_vs.bin.h"
+#include "Embeded/spirv/imgui_composite_ps.bin.h"
+#include "Embeded/spirv/imgui_composite_clear_ps.bin.h"
 #endif
 
 using namespace Core;
 
 #define HE_PROFILE_IMGUI 0x4300FF
 
+//////////////////////////////////////////////////////////////////////////
+// Worker Pool
+//////////////////////////////////////////////////////////////////////////
+
+// Fork/join pool used to record command lists in parallel. Threads are started on first use.
+struct WorkerPool
+{
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void(uint32_t)> job;
+    uint32_t jobCount = 0;
+    uint32_t nextJob = 0;
+    uint32_t finishedJobs = 0;
+    bool quit = false;
+
+    ~WorkerPool()
+    {
+        {
+            std::scoped_lock lock(mutex);
+            quit = true;
+        }
+
+        wake.notify_all();
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    void Start(uint32_t threadCount)
+    {
+        while (threads.size() < threadCount)
+            threads.emplace_back([this]() { WorkerLoop(); });
+    }
+
+    // Runs fn(0) .. fn(count - 1) with the calling thread taking part, returns once all of them are done
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& fn)
+    {
+        if (threads.empty() || count <= 1)
+        {
+            for (uint32_t i = 0; i < count; i++)
+                fn(i);
+            return;
+        }
+
+        std::unique_lock lock(mutex);
+        job = fn;
+        jobCount = count;
+        nextJob = 0;
+        finishedJobs = 0;
+        wake.notify_all();
+
+        RunJobs(lock);
+        done.wait(lock, [this]() { return finishedJobs == jobCount; });
+
+        job = nullptr;
+        jobCount = 0;
+        nextJob = 0;
+    }
+
+    void WorkerLoop()
+    {
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [this]() { return quit || nextJob < jobCount; });
+            if (quit)
+                return;
+
+            RunJobs(lock);
+        }
+    }
+
+    void RunJobs(std::unique_lock<std::mutex>& lock)
+    {
+        while (nextJob < jobCount)
+        {
+            const uint32_t index = nextJob++;
+
+            lock.unlock();
+            job(index);
+            lock.lock();
+
+            if (++finishedJobs == jobCount)
+                done.notify_all();
+        }
+    }
+};
+
 //////////////////////////////////////////////////////////////////////////
 // ImGui Backend
 //////////////////////////////////////////////////////////////////////////
 
-struct ImGuiBackend
+struct ImGuiBackend : public HEImGui::Context
 {
     nvrhi::DeviceHandle device;
-    nvrhi::CommandListHandle commandList;
 
     nvrhi::ShaderHandle vertexShader;
     nvrhi::ShaderHandle pixelShader;
@@ -44,33 +187,452 @@ struct ImGuiBackend
 
     nvrhi::SamplerHandle fontSampler;
 
-    nvrhi::BufferHandle vertexBuffer;
-    nvrhi::BufferHandle indexBuffer;
+    // A vertex or index buffer and the usage history its capacity policy is based on
+    struct GeometryBuffer
+    {
+        nvrhi::BufferHandle buffer;
+        uint8_t* mapped = nullptr;  // CPU-visible buffers only, mapped for their whole lifetime
+        bool isIndexBuffer = false;
+        bool cpuVisible = false;
+        size_t peakBytes = 0;       // largest use since the last shrink check
+        uint32_t quietFrames = 0;   // consecutive checks that found the buffer well below capacity
+
+        size_t ElementSize() const { return isIndexBuffer ? sizeof(ImDrawIdx) : sizeof(ImDrawVert); }
+        size_t Capacity() const { return buffer ? size_t(buffer->getDesc().byteSize) : 0; }
+    };
+
+    static constexpr uint32_t c_FramesInFlight = 3;
+
+    // CPU-visible geometry buffers of one frame in flight, suballocated by every viewport the context renders in that frame
+    struct UploadRing
+    {
+        GeometryBuffer vertexBuffer = { .isIndexBuffer = false, .cpuVisible = true };
+        GeometryBuffer indexBuffer = { .isIndexBuffer = true, .cpuVisible = true };
+        size_t vtxOffset = 0;
+        size_t idxOffset = 0;
+    };
+
+    // Staging texture that every texture update of a frame in one format is packed into, reused once the frame's fence has passed
+    struct StagingPage
+    {
+        nvrhi::StagingTextureHandle texture;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    struct FrameSlot
+    {
+        nvrhi::EventQueryHandle fence;
+        bool fencePending = false;
+        uint64_t frame = 0; // frame whose last submission the fence follows
+        std::array<StagingPage, 2> staging; // RGBA8, R8
+    };
+
+    std::array<FrameSlot, c_FramesInFlight> frames;
+    uint64_t frameIndex = 0;
+    uint64_t completedFrame = 0; // the GPU is done with every frame up to this one, the queue runs in order
+
+    // Where one draw list lives in the geometry buffers, in vertices and indices
+    struct ListPlacement
+    {
+        uint32_t vertexStart = 0;
+        uint32_t indexStart = 0;
+    };
+
+    // Where the geometry of the viewport being rendered lives
+    struct GeometryRange
+    {
+        nvrhi::IBuffer* vertexBuffer = nullptr;
+        nvrhi::IBuffer* indexBuffer = nullptr;
+        uint64_t vertexOffset = 0;
+        uint64_t indexOffset = 0;
+        const ListPlacement* lists = nullptr; // one per draw list when they aren't packed back to back
+    };
+
+    // Settings::incrementalGeometryUpload: draw lists are rounded up to this many elements, so a list that grows a little is rewritten in place
+    static constexpr uint32_t c_ResidentListGranularity = 64;
+
+    // First-fit allocator over the elements of a geometry buffer. Free ranges are sorted and coalesced, a range freed
+    // at the top lowers the top instead.
+    struct RegionAllocator
+    {
+        struct Range
+        {
+            uint32_t start = 0;
+            uint32_t count = 0;
+        };
+
+        std::vector<Range> freeRanges;
+        uint32_t top = 0;      // end of the highest allocation
+        uint32_t liveCount = 0;
+
+        void Reset()
+        {
+            freeRanges.clear();
+            top = 0;
+            liveCount = 0;
+        }
+
+        bool Allocate(uint32_t count, uint32_t capacity, uint32_t& start)
+        {
+            for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+            {
+                if (it->count < count)
+                    continue;
+
+                start = it->start;
+                it->start += count;
+                it->count -= count;
+                if (it->count == 0)
+                    freeRanges.erase(it);
+
+                liveCount += count;
+                return true;
+            }
+
+            if (top + count > capacity)
+                return false;
+
+            start = top;
+            top += count;
+            liveCount += count;
+            return true;
+        }
+
+        void Free(uint32_t start, uint32_t count)
+        {
+            liveCount -= count;
+
+            if (start + count == top)
+            {
+                top = start;
+                while (!freeRanges.empty() && freeRanges.back().start + freeRanges.back().count == top)
+                {
+                    top = freeRanges.back().start;
+                    freeRanges.pop_back();
+                }
+                return;
+            }
+
+            auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), start, [](const Range& r, uint32_t s) { return r.start < s; });
+            auto it = freeRanges.insert(next, { start, count });
+
+            if (it + 1 != freeRanges.end() && it->start + it->count == (it + 1)->start)
+            {
+                it->count += (it + 1)->count;
+                freeRanges.erase(it + 1);
+            }
+
+            if (it != freeRanges.begin() && (it - 1)->start + (it - 1)->count == it->start)
+            {
+                (it - 1)->count += it->count;
+                freeRanges.erase(it);
+            }
+        }
+
+        // Share of the allocated range that is free
+        float Fragmentation() const { return top ? float(top - liveCount) / float(top) : 0.0f; }
+    };
+
+    // A draw list kept in place across frames, with the hash of the geometry it was uploaded from
+    struct ResidentList
+    {
+        uint64_t hash = 0;
+        uint32_t vertexStart = 0, vertexCapacity = 0, vertexCount = 0;
+        uint32_t indexStart = 0, indexCapacity = 0, indexCount = 0;
+        uint64_t lastFrame = 0;
+        bool dirty = false; // to be written this frame
+    };
 
     nvrhi::BindingLayoutHandle bindingLayout;
     nvrhi::GraphicsPipelineDesc basePSODesc;
+    nvrhi::ShaderHandle alpha8PixelShader;
+    nvrhi::GraphicsPipelineDesc alpha8PSODesc;
+    nvrhi::ShaderHandle compositeVertexShader;
+    nvrhi::ShaderHandle compositePixelShader;
+    nvrhi::ShaderHandle compositeClearPixelShader;
+    nvrhi::GraphicsPipelineDesc compositePSODesc;
+    nvrhi::GraphicsPipelineDesc layerClearPSODesc;
+
+    enum class PipelineVariant : uint8_t
+    {
+        Default,
+        Alpha8,    // R8 textures, the red channel is the alpha
+        Bindless,  // covers both texel formats through PushConstants::alpha8
+        Composite,  // UI cache texture or window layer onto the framebuffer
+        LayerClear, // zeroes a window layer's region before it is redrawn
+    };
+
+    // Pipelines per framebuffer layout, few enough that a linear search beats hashing FramebufferInfo
+    struct CachedPipeline
+    {
+        nvrhi::FramebufferInfo framebufferInfo;
+        PipelineVariant variant = PipelineVariant::Default;
+        bool premultiplied = false; // accumulates coverage in alpha, for the UI cache texture
+        nvrhi::GraphicsPipelineHandle pipeline;
+    };
+
+    std::vector<CachedPipeline> pipelines;
+    size_t prewarmedFramebuffers = 0;
+
+    // Per-texture bindings: a binding set for the regular path and/or a descriptor table index for the bindless path.
+    // Entries are stored densely so the eviction sweep can resume where it stopped on the previous frame.
+    static constexpr uint32_t c_InvalidBindlessIndex = ~0u;
+
+    struct TextureBinding
+    {
+        nvrhi::TextureHandle texture;
+        nvrhi::BindingSetHandle bindingSet;
+        uint32_t bindlessIndex = c_InvalidBindlessIndex;
+        uint64_t lastUsedFrame = 0;
+    };
+
+    std::vector<TextureBinding> textureBindings;
+    std::unordered_map<nvrhi::ITexture*, uint32_t> textureBindingLookup;
+    uint32_t evictionCursor = 0;
+
+    // Resources dropped by the backend, tagged with the frame that dropped them and held until the GPU has retired it
+    struct DeferredRelease
+    {
+        nvrhi::ResourceHandle resource;
+        uint64_t frame = 0;
+    };
+
+    std::deque<DeferredRelease> deferredReleases;
+
+    // Texture updates of the frame, recorded into one command list that is submitted ahead of the draws
+    static constexpr uint32_t c_MinStagingPageSize = 256;
+
+    // Two update rects are uploaded as their union when it costs fewer texels than this plus their own areas,
+    // roughly what a separate copy costs in command and packing overhead
+    static constexpr uint32_t c_TextureCopyCostTexels = 4096;
+
+    struct TextureUpload
+    {
+        nvrhi::ITexture* texture = nullptr;
+        const uint8_t* pixels = nullptr; // first texel of the region in the CPU copy
+        uint32_t pitch = 0;              // row pitch of the CPU copy
+        uint32_t bytesPerPixel = 4;      // 1 for Alpha8 textures
+        uint32_t x = 0, y = 0, w = 0, h = 0;
+        uint32_t stagingX = 0, stagingY = 0;
+        bool atlasGrow = false;          // fills a grown atlas, counted apart from texture updates
+    };
+
+    nvrhi::CommandListHandle textureCommandList;
+    bool textureCommandListOpen = false;
+    std::vector<TextureUpload> textureUploads;
+
+    // Grown atlases: regions the new texture takes over from the old one, recorded after the staging copies
+    // so the old texture's own pending updates land first
+    static constexpr uint32_t c_AtlasGrowTileSize = 64;
+
+    struct TextureCopy
+    {
+        nvrhi::ITexture* dst = nullptr;
+        nvrhi::ITexture* src = nullptr;
+        uint32_t x = 0, y = 0, w = 0, h = 0;
+    };
+
+    std::vector<TextureCopy> textureCopies;
+    std::vector<ImTextureRect> updateRects;
+    bool texturesChanged = false; // a texture was created, updated or destroyed this frame
 
-    nvrhi::GraphicsPipelineHandle pso;
-    std::unordered_map<nvrhi::ITexture*, nvrhi::BindingSetHandle> bindingsCache;
+    // Settings::cacheUI: the main viewport drawn over transparent black with premultiplied alpha, and the hash of the
+    // draw data it was drawn from
+    struct UICache
+    {
+        nvrhi::TextureHandle texture;
+        nvrhi::FramebufferHandle framebuffer;
+        uint64_t hash = 0;
+        bool valid = false;
+    };
+
+    UICache uiCache;
+
+    // Bindless path: every texture lives in one descriptor table and draws select it through the push constants.
+    // The table is sized once when it is created: resizing it would free the descriptor range that recorded command
+    // lists and frames in flight still point at.
 
-    std::vector<ImDrawVert> vtxBuffer;
-    std::vector<ImDrawIdx> idxBuffer;
+    struct RetiredBindlessSlot
+    {
+        uint32_t index = 0;
+        uint64_t frame = 0;
+    };
+
+    nvrhi::ShaderHandle bindlessPixelShader;
+    nvrhi::BindingLayoutHandle bindlessBindingLayout;
+    nvrhi::BindingLayoutHandle bindlessLayout;
+    nvrhi::GraphicsPipelineDesc bindlessPSODesc;
+    nvrhi::BindingSetHandle bindlessBindingSet;
+    nvrhi::DescriptorTableHandle descriptorTable;
+    uint32_t bindlessCapacity = 0;
+    bool bindlessTableCreated = false; // attempted, the layout fails on devices without descriptor indexing
+    uint32_t nextBindlessIndex = 0;
+    bool descriptorTableFull = false; // every slot is taken, the regular path takes over
+    std::vector<RetiredBindlessSlot> retiredBindlessSlots;
 
     struct PushConstants
     {
         ImVec2 scale;
         ImVec2 translate;
+        uint32_t textureIndex = 0; // bindless path only
+        uint32_t alpha8 = 0;       // bindless path only, the texture is R8
+    };
+
+    // One drawIndexed call, or a user callback when 'callback' is set
+    struct DrawBatch
+    {
+        nvrhi::ITexture* texture = nullptr;
+        nvrhi::IBindingSet* bindings = nullptr;
+        uint32_t textureIndex = 0; // bindless path only
+        bool alpha8 = false;
+        nvrhi::Rect scissor;
+        uint32_t indexCount = 0;
+        uint32_t startIndex = 0;
+        uint32_t startVertex = 0;
+
+        const ImDrawList* cmdList = nullptr;
+        const ImDrawCmd* callback = nullptr;
+
+        // a window drawn from its layer, 'scissor' is its rect and 'bindings' hold the layer atlas
+        bool layer = false;
+        int layerOffsetX = 0; // atlas texel minus framebuffer pixel
+        int layerOffsetY = 0;
+    };
+
+    // Everything the command lists recording one viewport share
+    struct ViewportState
+    {
+        nvrhi::GraphicsState drawState;
+        nvrhi::IGraphicsPipeline* pipeline = nullptr;       // RGBA textures, or every texture on the bindless path
+        nvrhi::IGraphicsPipeline* alpha8Pipeline = nullptr; // R8 textures
+        nvrhi::IGraphicsPipeline* compositePipeline = nullptr; // window layers
+        PushConstants pushConstants;
+        bool bindless = false;
+    };
+
+    // HEImGui::CacheWindowLayer(): windows drawn into regions of an atlas, premultiplied over transparent black.
+    // Regions are packed on shelves and kept while the window fits in them, a full atlas is packed again from scratch.
+    static constexpr uint32_t c_LayerGranularity = 16;
+    static constexpr uint32_t c_LayerStaleFrames = 60;
+
+    struct WindowLayer
+    {
+        uint64_t hash = 0;
+        nvrhi::Rect bounds;      // framebuffer pixels
+        uint32_t x = 0, y = 0;   // region in the atlas
+        uint32_t w = 0, h = 0;
+        uint64_t lastFrame = 0;
+        bool valid = false;      // the region holds the window as hashed
+        bool placed = false;
+        bool redraw = false;
+    };
+
+    struct LayerShelf
+    {
+        uint32_t y = 0;
+        uint32_t height = 0;
+        uint32_t x = 0;
+    };
+
+    struct WindowLayers
+    {
+        nvrhi::TextureHandle atlas;
+        nvrhi::FramebufferHandle framebuffer;
+        std::vector<LayerShelf> shelves;
+        std::unordered_map<const ImDrawList*, WindowLayer> layers;
+        std::vector<int> frameLists; // draw lists of the viewport drawn from their layer this frame
+        std::vector<DrawBatch> scratch;
+        uint64_t lastLayerFrame = 0; // the atlas is released once no layer was drawn for c_LayerStaleFrames
+    };
+
+    // Command list, geometry and draw batches of one viewport. Contexts share nothing but the backend caches,
+    // which are only touched while a viewport is prepared on the calling thread, so contexts can record concurrently.
+    struct RenderContext
+    {
+        nvrhi::CommandListHandle commandList;
+
+        GeometryBuffer vertexBuffer = { .isIndexBuffer = false };
+        GeometryBuffer indexBuffer = { .isIndexBuffer = true };
+        std::vector<ImDrawVert> vtxBuffer;
+        std::vector<ImDrawIdx> idxBuffer;
+        std::array<UploadRing, c_FramesInFlight> rings;
+        uint64_t lastFrame = 0;
+
+        // Settings::incrementalGeometryUpload, what 'vertexBuffer' and 'indexBuffer' hold per draw list
+        std::unordered_map<const ImDrawList*, ResidentList> residentLists;
+        RegionAllocator vertexRegions;
+        RegionAllocator indexRegions;
+        nvrhi::IBuffer* residentVertexBuffer = nullptr; // the buffers the regions were laid out in, anything else starts over
+        nvrhi::IBuffer* residentIndexBuffer = nullptr;
+        std::vector<ListPlacement> listPlacements;
+
+        std::vector<uint32_t> listFirstBatch; // per draw list of the viewport, plus the end of the last one
+        WindowLayers layers;
+
+        std::vector<DrawBatch> batches;
+        bool batchesHaveCallbacks = false; // user callbacks other than ImDrawCallback_ResetRenderState
+        ViewportState viewport;
+        uint32_t chunkCount = 1;
+
+        // extra command lists for parallel recording, the first chunk always goes into 'commandList'
+        std::vector<nvrhi::CommandListHandle> chunkCommandLists;
+        std::vector<HEImGui::FrameStats> chunkStats;
+        HEImGui::FrameStats recordStats;
+    };
+
+    struct ViewportTarget
+    {
+        RenderContext* context = nullptr;
+        ImDrawData* drawData = nullptr;
+        nvrhi::IFramebuffer* framebuffer = nullptr;
+    };
+
+    RenderContext mainContext; // also the frame arena of every viewport with ViewportSubmission::Batched
+    WorkerPool workers;
+    std::vector<nvrhi::ICommandList*> submitCommandLists;
+    std::vector<RenderContext*> submitContexts;
+    std::vector<uint32_t> parallelTargets; // RenderViewports, the targets recorded on the worker pool
+    std::vector<ImDrawData*> batchedDrawData;
+    std::vector<GeometryRange> batchedGeometry;
+    std::vector<const ImDrawList*> frameLayerRequests; // HEImGui::CacheWindowLayer() calls of the frame being rendered, sorted
+
+    // Settings::parallelRecordBenchmark: average recording time of single vs multi-threaded recording, per draw count
+    struct RecordBenchmark
+    {
+        struct Bucket
+        {
+            double singleMicroseconds = 0.0;
+            double parallelMicroseconds = 0.0;
+            uint32_t singleSamples = 0;
+            uint32_t parallelSamples = 0;
+        };
+
+        std::array<Bucket, 20> buckets; // bucket i holds viewports with [2^i, 2^(i+1)) draw batches
+        uint32_t samples = 0;
+    };
+
+    RecordBenchmark recordBenchmark;
+
+    // What was last set on the command list, so unchanged state is not sent to nvrhi again
+    struct StateTracker
+    {
+        nvrhi::IBindingSet* bindings = nullptr;
+        nvrhi::Rect scissor;
+        uint32_t textureIndex = 0;
+        bool alpha8 = false;
+        bool stateValid = false;
+        bool constantsValid = false;
     };
 
-    bool Init(nvrhi::DeviceHandle pDevice)
+    bool Init(nvrhi::DeviceHandle pDevice, const nvrhi::FramebufferInfo& mainFramebufferInfo)
     {
         CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
 
         device = pDevice;
 
-        nvrhi::CommandListParameters clp;
-        clp.enableImmediateExecution = device->getGraphicsAPI() == nvrhi::GraphicsAPI::D3D11;
-        commandList = device->createCommandList(clp);
+        for (FrameSlot& frame : frames)
+            frame.fence = device->createEventQuery();
 
         {
             CORE_PROFILE_SCOPE_NC("Create Shaders", HE_PROFILE_IMGUI);
@@ -89,6 +651,26 @@ struct ImGuiBackend
             pixelShader = RHI::CreateStaticShader(device, STATIC_SHADER(imgui_main_ps), nullptr, psDesc);
             CORE_ASSERT(vertexShader);
             CORE_ASSERT(pixelShader);
+
+            psDesc.debugName = "imgui_ps_alpha8";
+            psDesc.entryName = "main_ps_alpha8";
+            alpha8PixelShader = RHI::CreateStaticShader(device, STATIC_SHADER(imgui_main_ps_alpha8), nullptr, psDesc);
+            CORE_ASSERT(alpha8PixelShader);
+
+            vsDesc.debugName = "imgui_composite_vs";
+            vsDesc.entryName = "composite_vs";
+            compositeVertexShader = RHI::CreateStaticShader(device, STATIC_SHADER(imgui_composite_vs), nullptr, vsDesc);
+            CORE_ASSERT(compositeVertexShader);
+
+            psDesc.debugName = "imgui_composite_ps";
+            psDesc.entryName = "composite_ps";
+            compositePixelShader = RHI::CreateStaticShader(device, STATIC_SHADER(imgui_composite_ps), nullptr, psDesc);
+            CORE_ASSERT(compositePixelShader);
+
+            psDesc.debugName = "imgui_composite_clear_ps";
+            psDesc.entryName = "composite_clear_ps";
+            compositeClearPixelShader = RHI::CreateStaticShader(device, STATIC_SHADER(imgui_composite_clear_ps), nullptr, psDesc);
+            CORE_ASSERT(compositeClearPixelShader);
         }
 
         {
@@ -145,6 +727,48 @@ struct ImGuiBackend
             basePSODesc.PS = pixelShader;
             basePSODesc.renderState = renderState;
             basePSODesc.bindingLayouts = { bindingLayout };
+
+            alpha8PSODesc = basePSODesc;
+            alpha8PSODesc.PS = alpha8PixelShader;
+
+            // the cache texture and the layers hold premultiplied color, the full-screen triangle needs no vertex input
+            compositePSODesc = basePSODesc;
+            compositePSODesc.inputLayout = nullptr;
+            compositePSODesc.VS = compositeVertexShader;
+            compositePSODesc.PS = compositePixelShader;
+            compositePSODesc.renderState.blendState.targets[0]
+                .setSrcBlend(nvrhi::BlendFactor::One)
+                .setSrcBlendAlpha(nvrhi::BlendFactor::One)
+                .setDestBlendAlpha(nvrhi::BlendFactor::InvSrcAlpha);
+
+            // binds nothing, the atlas it clears can't be bound for sampling at the same time
+            layerClearPSODesc = compositePSODesc;
+            layerClearPSODesc.PS = compositeClearPixelShader;
+            layerClearPSODesc.bindingLayouts = {};
+            layerClearPSODesc.renderState.blendState.targets[0].setBlendEnable(false);
+        }
+
+        if (device->getGraphicsAPI() != nvrhi::GraphicsAPI::D3D11)
+        {
+            CORE_PROFILE_SCOPE_NC("Create Bindless Resources", HE_PROFILE_IMGUI);
+
+            nvrhi::ShaderDesc psDesc;
+            psDesc.shaderType = nvrhi::ShaderType::Pixel;
+            psDesc.debugName = "imgui_ps_bindless";
+            psDesc.entryName = "main_ps_bindless";
+            bindlessPixelShader = RHI::CreateStaticShader(device, STATIC_SHADER(imgui_main_ps_bindless), nullptr, psDesc);
+
+            // the descriptor table itself waits for Settings::bindlessTextures, see CreateDescriptorTable()
+            if (bindlessPixelShader)
+            {
+                nvrhi::BindingLayoutDesc layoutDesc;
+                layoutDesc.visibility = nvrhi::ShaderType::All;
+                layoutDesc.bindings = {
+                    nvrhi::BindingLayoutItem::PushConstants(0, sizeof(PushConstants)),
+                    nvrhi::BindingLayoutItem::Sampler(0)
+                };
+                bindlessBindingLayout = device->createBindingLayout(layoutDesc);
+            }
         }
 
         {
@@ -158,323 +782,2878 @@ struct ImGuiBackend
 
             if (fontSampler == nullptr)
                 return false;
+
+            // the whole frame draws with this one binding set on the bindless path
+            if (bindlessBindingLayout)
+            {
+                nvrhi::BindingSetDesc setDesc;
+                setDesc.bindings = {
+                    nvrhi::BindingSetItem::PushConstants(0, sizeof(PushConstants)),
+                    nvrhi::BindingSetItem::Sampler(0, fontSampler)
+                };
+                bindlessBindingSet = device->createBindingSet(setDesc, bindlessBindingLayout);
+            }
+        }
+
+        {
+            CORE_PROFILE_SCOPE_NC("Prewarm Pipelines", HE_PROFILE_IMGUI);
+
+            PrewarmPipelines(mainFramebufferInfo);
         }
 
         return true;
     }
 
-    bool Render(ImDrawData* drawData, nvrhi::IFramebuffer* framebuffer)
+    bool Render(ImDrawData* drawData, nvrhi::IFramebuffer* framebuffer, RenderContext& ctx)
     {
         CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
 
-        CORE_ASSERT(framebuffer);
-
-        for (ImTextureData* tex : ImGui::GetPlatformIO().Textures)
-            if (tex->Status != ImTextureStatus_OK)
-                UpdateTexture(tex);
-
-        float fbWidth = (float)(drawData->DisplaySize.x * drawData->FramebufferScale.x);
-        float fbHeight = (float)(drawData->DisplaySize.y * drawData->FramebufferScale.y);
+        UpdateTextures();
 
+        nvrhi::ICommandList* commandList = GetCommandList(ctx);
         commandList->open();
         commandList->beginMarker("ImGui");
         BUILTIN_PROFILE_BEGIN(device, commandList, "ImGui Render");
 
-        if (!UpdateGeometry(drawData, commandList))
+        if (!PrepareViewport(ctx, drawData, framebuffer, true))
         {
             commandList->close();
             return false;
         }
 
-        // handle DPI scaling
-        drawData->ScaleClipRects(drawData->FramebufferScale);
+        RecordViewport(ctx);
 
-        PushConstants pushConstants;
-        pushConstants.scale.x = 2 / drawData->DisplaySize.x;
-        pushConstants.scale.y = 2 / drawData->DisplaySize.y;
-        pushConstants.translate.x = -1 - drawData->DisplayPos.x * pushConstants.scale.x;
-        pushConstants.translate.y = -1 - drawData->DisplayPos.y * pushConstants.scale.y;
-        
-        // set up graphics state
-        nvrhi::GraphicsState drawState;
-        drawState.framebuffer = framebuffer;
-        drawState.pipeline = GetPSO(drawState.framebuffer);
-        drawState.viewport.viewports.push_back(nvrhi::Viewport(fbWidth, fbHeight));
-        drawState.viewport.scissorRects.resize(1);  // updated below
+        BUILTIN_PROFILE_END();
+        commandList->endMarker();
+        commandList->close();
 
-        nvrhi::VertexBufferBinding vbufBinding;
-        vbufBinding.buffer = vertexBuffer;
-        vbufBinding.slot = 0;
-        vbufBinding.offset = 0;
-        drawState.vertexBuffers.push_back(vbufBinding);
+        MergeRecordStats(ctx);
 
-        drawState.indexBuffer.buffer = indexBuffer;
-        drawState.indexBuffer.format = (sizeof(ImDrawIdx) == 2 ? nvrhi::Format::R16_UINT : nvrhi::Format::R32_UINT);
-        drawState.indexBuffer.offset = 0;
+        RenderContext* contexts[] = { &ctx };
+        Submit(contexts, 1);
 
-        // Will project scissor/clipping rectangles into framebuffer space
-        ImVec2 clipOff = drawData->DisplayPos;         // (0,0) unless using multi-viewports
-        ImVec2 clipScale = drawData->FramebufferScale; // (1,1) unless using retina display which are often (2,2)
+        return true;
+    }
 
-        // render command lists
-        int vtxOffset = 0;
-        int idxOffset = 0;
-        for (int n = 0; n < drawData->CmdListsCount; n++)
+    // Settings::cacheUI: redraws the viewport into the cache texture only when its draw data or a texture changed, then
+    // blends the cache onto the framebuffer. Frames that can't be cached fall back to Render, unless 'keepOffscreen'
+    // asks for the cache texture to hold the frame anyway, redrawn every time.
+    bool RenderCached(ImDrawData* drawData, nvrhi::IFramebuffer* framebuffer, RenderContext& ctx, bool keepOffscreen = false)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        CORE_ASSERT(framebuffer);
+
+        // hashed before SetupViewport scales the clip rects in place
+        uint64_t hash = 0;
+        const bool cacheable = framebuffer->getFramebufferInfo().sampleCount == 1 && HashDrawData(drawData, hash);
+        if (!cacheable && !keepOffscreen)
         {
-            const ImDrawList* cmdList = drawData->CmdLists[n];
-            for (int i = 0; i < cmdList->CmdBuffer.Size; i++)
+            uiCache.valid = false;
+            totals.uiCacheBypasses++;
+            return Render(drawData, framebuffer, ctx);
+        }
+
+        UpdateTextures();
+
+        const bool recreated = EnsureUICacheTarget(framebuffer);
+        const bool hit = cacheable && uiCache.valid && !recreated && !texturesChanged && !invalidateUICache && hash == uiCache.hash;
+        invalidateUICache = false;
+
+        nvrhi::ICommandList* commandList = GetCommandList(ctx);
+        commandList->open();
+        commandList->beginMarker("ImGui");
+        BUILTIN_PROFILE_BEGIN(device, commandList, "ImGui Render");
+
+        if (hit)
+        {
+            ctx.batches.clear();
+            ctx.chunkCount = 1;
+            ctx.recordStats = {};
+
+            stats.uiCacheHit = true;
+            totals.uiCacheHits++;
+        }
+        else
+        {
+            commandList->clearTextureFloat(uiCache.texture, nvrhi::AllSubresources, nvrhi::Color(0.0f));
+
+            if (!PrepareViewport(ctx, drawData, uiCache.framebuffer, false, true))
             {
-                const ImDrawCmd* pCmd = &cmdList->CmdBuffer[i];
+                uiCache.valid = false;
+                commandList->close();
+                return false;
+            }
 
-                if (pCmd->UserCallback)
-                {
-                    pCmd->UserCallback(cmdList, pCmd);
-                }
-                else
-                {
-                    drawState.bindings = { GetBindingSet((nvrhi::ITexture*)pCmd->GetTexID())};
-                    CORE_ASSERT(drawState.bindings[0]);
-
-                    ImVec2 clipMin((pCmd->ClipRect.x - clipOff.x) * clipScale.x, (pCmd->ClipRect.y - clipOff.y) * clipScale.y);
-                    ImVec2 clipMax((pCmd->ClipRect.z - clipOff.x) * clipScale.x, (pCmd->ClipRect.w - clipOff.y) * clipScale.y);
-
-                    if (clipMin.x < 0.0f) { clipMin.x = 0.0f; }
-                    if (clipMin.y < 0.0f) { clipMin.y = 0.0f; }
-                    if (clipMax.x > fbWidth) { clipMax.x = (float)fbWidth; }
-                    if (clipMax.y > fbHeight) { clipMax.y = (float)fbHeight; }
-                    if (clipMax.x <= clipMin.x || clipMax.y <= clipMin.y) continue;
-                        
-                    drawState.viewport.scissorRects[0] = nvrhi::Rect((int)clipMin.x, (int)clipMax.x, (int)clipMin.y, (int)clipMax.y);
-
-                    nvrhi::DrawArguments drawArguments;
-                    drawArguments.vertexCount = pCmd->ElemCount;
-                    drawArguments.startIndexLocation = pCmd->IdxOffset + idxOffset;
-                    drawArguments.startVertexLocation = pCmd->VtxOffset + vtxOffset;
-
-                    commandList->setGraphicsState(drawState);
-                    commandList->setPushConstants(&pushConstants, sizeof(PushConstants));
-                    commandList->drawIndexed(drawArguments);
-                }
+            RecordViewport(ctx);
+            MergeRecordStats(ctx);
+
+            uiCache.hash = hash;
+            uiCache.valid = true;
+            totals.uiCacheMisses++;
+        }
+
+        RecordUICacheComposite(commandList, framebuffer);
+
+        BUILTIN_PROFILE_END();
+        commandList->endMarker();
+        commandList->close();
+
+        RenderContext* contexts[] = { &ctx };
+        Submit(contexts, 1);
+
+        return true;
+    }
+
+    // Settings::decoupledUIUpdates, frames between UI updates: the last UI drawn into the cache goes over the new
+    // scene as it is. False when there's nothing to composite, or it was drawn for another framebuffer size or
+    // format, in which case the cache is dropped so the next frame updates the UI.
+    bool CompositeUICache(nvrhi::IFramebuffer* framebuffer, RenderContext& ctx)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        CORE_ASSERT(framebuffer);
+
+        const nvrhi::FramebufferInfoEx& framebufferInfo = framebuffer->getFramebufferInfo();
+        const nvrhi::TextureDesc* cacheDesc = uiCache.valid ? &uiCache.texture->getDesc() : nullptr;
+        if (!cacheDesc || cacheDesc->width != framebufferInfo.width || cacheDesc->height != framebufferInfo.height ||
+            framebufferInfo.colorFormats.empty() || cacheDesc->format != framebufferInfo.colorFormats[0])
+        {
+            uiCache.valid = false;
+            return false;
+        }
+
+        nvrhi::ICommandList* commandList = GetCommandList(ctx);
+        commandList->open();
+        commandList->beginMarker("ImGui");
+
+        ctx.batches.clear();
+        ctx.chunkCount = 1;
+        RecordUICacheComposite(commandList, framebuffer);
+
+        commandList->endMarker();
+        commandList->close();
+
+        RenderContext* contexts[] = { &ctx };
+        Submit(contexts, 1);
+
+        stats.uiSkipped = true;
+        totals.uiSkippedFrames++;
+
+        return true;
+    }
+
+    void RecordUICacheComposite(nvrhi::ICommandList* commandList, nvrhi::IFramebuffer* framebuffer)
+    {
+        const nvrhi::FramebufferInfoEx& framebufferInfo = framebuffer->getFramebufferInfo();
+
+        nvrhi::GraphicsState compositeState;
+        compositeState.pipeline = GetPSO(framebufferInfo, PipelineVariant::Composite);
+        compositeState.framebuffer = framebuffer;
+        compositeState.bindings = { GetBindingSet(uiCache.texture) };
+        compositeState.viewport.addViewportAndScissorRect(nvrhi::Viewport(float(framebufferInfo.width), float(framebufferInfo.height)));
+        commandList->setGraphicsState(compositeState);
+
+        const PushConstants compositeConstants;
+        commandList->setPushConstants(&compositeConstants, sizeof(PushConstants));
+
+        nvrhi::DrawArguments drawArguments;
+        drawArguments.vertexCount = 3;
+        commandList->draw(drawArguments);
+
+        stats.drawCalls++;
+        stats.stateChanges++;
+    }
+
+    static constexpr uint64_t c_HashSeed = 14695981039346656037ull;
+
+    // Word-wise FNV-1a, the geometry is large enough that byte-wise hashing would cost more than the draws
+    static void HashBytes(uint64_t& h, const void* data, size_t size)
+    {
+        const uint8_t* bytes = (const uint8_t*)data;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            h = (h ^ word) * 1099511628211ull;
+        }
+
+        for (; i < size; i++)
+            h = (h ^ bytes[i]) * 1099511628211ull;
+
+        h = (h ^ size) * 1099511628211ull;
+    }
+
+    // Everything the pixels of the viewport depend on, bar the texture contents. False when the frame can't be cached:
+    // user callbacks draw outside the draw data, and user textures may change behind an unchanged ImTextureID.
+    bool HashDrawData(const ImDrawData* drawData, uint64_t& hash) const
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        uint64_t h = c_HashSeed;
+        const auto mix = [&h](const void* data, size_t size) { HashBytes(h, data, size); };
+
+        mix(&drawData->DisplayPos, sizeof(ImVec2));
+        mix(&drawData->DisplaySize, sizeof(ImVec2));
+        mix(&drawData->FramebufferScale, sizeof(ImVec2));
+
+        for (int n = 0; n < drawData->CmdListsCount; n++)
+        {
+            const ImDrawList* cmdList = drawData->CmdLists[n];
+
+            for (const ImDrawCmd& cmd : cmdList->CmdBuffer)
+            {
+                if (cmd.UserCallback)
+                {
+                    if (cmd.UserCallback != ImDrawCallback_ResetRenderState)
+                        return false;
+                    continue;
+                }
+
+                if (!cmd.TexRef._TexData && !settings.uiCacheStaticUserTextures)
+                    return false;
+
+                const ImTextureID texID = cmd.GetTexID();
+                mix(&cmd.ClipRect, sizeof(ImVec4));
+                mix(&texID, sizeof(texID));
+                mix(&cmd.VtxOffset, sizeof(cmd.VtxOffset));
+                mix(&cmd.IdxOffset, sizeof(cmd.IdxOffset));
+                mix(&cmd.ElemCount, sizeof(cmd.ElemCount));
+            }
+
+            mix(cmdList->VtxBuffer.Data, cmdList->VtxBuffer.size_in_bytes());
+            mix(cmdList->IdxBuffer.Data, cmdList->IdxBuffer.size_in_bytes());
+        }
+
+        hash = h;
+        return true;
+    }
+
+    // (Re)creates the cache texture to match the framebuffer, returns true when it did
+    bool EnsureUICacheTarget(nvrhi::IFramebuffer* framebuffer)
+    {
+        const nvrhi::FramebufferInfoEx& framebufferInfo = framebuffer->getFramebufferInfo();
+        const nvrhi::Format format = framebufferInfo.colorFormats[0];
+
+        if (uiCache.texture)
+        {
+            const nvrhi::TextureDesc& desc = uiCache.texture->getDesc();
+            if (desc.width == framebufferInfo.width && desc.height == framebufferInfo.height && desc.format == format)
+                return false;
+        }
+
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        // the previous frames may still be sampling the old texture
+        DeferRelease(uiCache.framebuffer);
+        DeferRelease(uiCache.texture);
+
+        nvrhi::TextureDesc desc;
+        desc.width = framebufferInfo.width;
+        desc.height = framebufferInfo.height;
+        desc.format = format;
+        desc.isRenderTarget = true;
+        desc.clearValue = nvrhi::Color(0.0f);
+        desc.useClearValue = true;
+        desc.initialState = nvrhi::ResourceStates::ShaderResource;
+        desc.keepInitialState = true;
+        desc.debugName = "ImGui UI Cache";
+
+        uiCache.texture = device->createTexture(desc);
+        CORE_ASSERT(uiCache.texture);
+
+        uiCache.framebuffer = device->createFramebuffer(nvrhi::FramebufferDesc().addColorAttachment(uiCache.texture));
+        uiCache.valid = false;
+
+        PrewarmPipelines(uiCache.framebuffer->getFramebufferInfo(), true);
+        if (!FindPSO(framebufferInfo, PipelineVariant::Composite))
+            CreatePSO(framebufferInfo, PipelineVariant::Composite);
+
+        return true;
+    }
+
+    // Prepares every viewport on the calling thread, records them in parallel on the worker threads and submits them
+    // all at once, in order. Viewports with user callbacks record on the calling thread. Chunked recording is off for
+    // these viewports, the worker pool doesn't nest.
+    bool RenderViewports(const ViewportTarget* targets, uint32_t count)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        UpdateTextures();
+
+        uint32_t prepared = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const ViewportTarget& target = targets[i];
+
+            nvrhi::ICommandList* commandList = GetCommandList(*target.context);
+            commandList->open();
+            commandList->beginMarker("ImGui");
+
+            // failed viewports are submitted empty so the order of the others holds
+            if (PrepareViewport(*target.context, target.drawData, target.framebuffer, false))
+            {
+                prepared++;
+            }
+            else
+            {
+                target.context->batches.clear();
+                target.context->chunkCount = 1;
+            }
+        }
+
+        const auto record = [&](uint32_t i) {
+
+            RenderContext& ctx = *targets[i].context;
+            RecordViewport(ctx);
+            ctx.commandList->endMarker();
+            ctx.commandList->close();
+        };
+
+        // D3D11 records straight into the immediate context, which is single threaded
+        if (device->getGraphicsAPI() == nvrhi::GraphicsAPI::D3D11 || settings.parallelRecordMaxThreads == 0)
+        {
+            for (uint32_t i = 0; i < count; i++)
+                record(i);
+        }
+        else
+        {
+            // user callbacks touch ImGui and application state: their viewports record here, in order, before the others
+            parallelTargets.clear();
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (targets[i].context->batchesHaveCallbacks)
+                    record(i);
+                else
+                    parallelTargets.push_back(i);
+            }
+
+            const uint32_t parallelCount = uint32_t(parallelTargets.size());
+            if (parallelCount)
+            {
+                workers.Start(std::min(parallelCount - 1, settings.parallelRecordMaxThreads));
+                workers.ParallelFor(parallelCount, [&](uint32_t i) { record(parallelTargets[i]); });
+            }
+        }
+
+        submitContexts.clear();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            MergeRecordStats(*targets[i].context);
+            submitContexts.push_back(targets[i].context);
+        }
+
+        Submit(submitContexts.data(), count);
+
+        return prepared == count;
+    }
+
+    // Uploads the geometry of every viewport at once into mainContext's buffers and records all of them into its
+    // command list, one viewport after the other, then submits that single command list.
+    bool RenderViewportsBatched(const ViewportTarget* targets, uint32_t count)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        UpdateTextures();
+
+        RenderContext& ctx = mainContext;
+        nvrhi::ICommandList* commandList = GetCommandList(ctx);
+        commandList->open();
+        commandList->beginMarker("ImGui");
+        BUILTIN_PROFILE_BEGIN(device, commandList, "ImGui Render");
+
+        BeginContextFrame(ctx);
+
+        batchedDrawData.clear();
+        for (uint32_t i = 0; i < count; i++)
+            batchedDrawData.push_back(targets[i].drawData);
+
+        batchedGeometry.resize(count);
+        if (!UpdateGeometry(ctx, batchedDrawData.data(), count, batchedGeometry.data()))
+        {
+            commandList->close();
+            return false;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            CORE_ASSERT(targets[i].framebuffer);
+
+            SetupViewport(ctx, targets[i].drawData, targets[i].framebuffer, batchedGeometry[i], false);
+            RecordViewport(ctx);
+            MergeRecordStats(ctx);
+        }
+
+        BUILTIN_PROFILE_END();
+        commandList->endMarker();
+        commandList->close();
+
+        RenderContext* contexts[] = { &ctx };
+        Submit(contexts, 1);
+
+        return true;
+    }
+
+    void UpdateTextures()
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        textureUploads.clear();
+        textureCopies.clear();
+
+        for (ImTextureData* tex : ImGui::GetPlatformIO().Textures)
+            if (tex->Status != ImTextureStatus_OK)
+            {
+                UpdateTexture(tex);
+                texturesChanged = true;
+            }
+
+        if (!textureUploads.empty() || !textureCopies.empty())
+            FlushTextureUploads();
+    }
+
+    nvrhi::ICommandList* GetTextureCommandList()
+    {
+        if (!textureCommandList)
+        {
+            nvrhi::CommandListParameters clp;
+            clp.enableImmediateExecution = device->getGraphicsAPI() == nvrhi::GraphicsAPI::D3D11;
+            textureCommandList = device->createCommandList(clp);
+        }
+
+        if (!textureCommandListOpen)
+        {
+            textureCommandList->open();
+            textureCommandList->beginMarker("ImGui Textures");
+            textureCommandListOpen = true;
+        }
+
+        return textureCommandList;
+    }
+
+    nvrhi::ICommandList* GetCommandList(RenderContext& ctx)
+    {
+        if (!ctx.commandList)
+        {
+            nvrhi::CommandListParameters clp;
+            clp.enableImmediateExecution = device->getGraphicsAPI() == nvrhi::GraphicsAPI::D3D11;
+            ctx.commandList = device->createCommandList(clp);
+        }
+
+        return ctx.commandList;
+    }
+
+    // Calling thread only: uploads the geometry into the open command list and resolves everything recording needs
+    bool PrepareViewport(RenderContext& ctx, ImDrawData* drawData, nvrhi::IFramebuffer* framebuffer, bool allowChunks, bool premultiplied = false)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        CORE_ASSERT(framebuffer);
+
+        BeginContextFrame(ctx);
+
+        GeometryRange geometry;
+        if (!UpdateGeometry(ctx, &drawData, 1, &geometry))
+            return false;
+
+        SetupViewport(ctx, drawData, framebuffer, geometry, allowChunks, premultiplied);
+
+        return true;
+    }
+
+    // Rewinds the context's upload ring and trims its buffers, once per frame
+    void BeginContextFrame(RenderContext& ctx)
+    {
+        if (ctx.lastFrame != frameIndex)
+        {
+            ctx.lastFrame = frameIndex;
+
+            // a ring slot is only checked when it comes back around, so its quiet frames count every c_FramesInFlight frames
+            UploadRing& ring = ctx.rings[frameIndex % c_FramesInFlight];
+            ring.vtxOffset = 0;
+            ring.idxOffset = 0;
+
+            if (ShrinkIfQuiet(ctx.vertexBuffer))
+            {
+                ctx.vtxBuffer.clear();
+                ctx.vtxBuffer.shrink_to_fit();
+            }
+
+            if (ShrinkIfQuiet(ctx.indexBuffer))
+            {
+                ctx.idxBuffer.clear();
+                ctx.idxBuffer.shrink_to_fit();
+            }
+
+            ShrinkIfQuiet(ring.vertexBuffer);
+            ShrinkIfQuiet(ring.indexBuffer);
+
+            stats.vertexBufferBytes += ctx.vertexBuffer.Capacity() + ring.vertexBuffer.Capacity();
+            stats.indexBufferBytes += ctx.indexBuffer.Capacity() + ring.indexBuffer.Capacity();
+        }
+    }
+
+    void SetupViewport(RenderContext& ctx, ImDrawData* drawData, nvrhi::IFramebuffer* framebuffer, const GeometryRange& geometry, bool allowChunks, bool premultiplied = false)
+    {
+        float fbWidth = (float)(drawData->DisplaySize.x * drawData->FramebufferScale.x);
+        float fbHeight = (float)(drawData->DisplaySize.y * drawData->FramebufferScale.y);
+
+        // handle DPI scaling
+        drawData->ScaleClipRects(drawData->FramebufferScale);
+
+        ViewportState& viewport = ctx.viewport;
+        viewport = {};
+        viewport.bindless = UseBindless();
+
+        PushConstants& pushConstants = viewport.pushConstants;
+        pushConstants.scale.x = 2 / drawData->DisplaySize.x;
+        pushConstants.scale.y = 2 / drawData->DisplaySize.y;
+        pushConstants.translate.x = -1 - drawData->DisplayPos.x * pushConstants.scale.x;
+        pushConstants.translate.y = -1 - drawData->DisplayPos.y * pushConstants.scale.y;
+
+        // set up graphics state
+        nvrhi::GraphicsState& drawState = viewport.drawState;
+        drawState.framebuffer = framebuffer;
+        const nvrhi::FramebufferInfo& framebufferInfo = framebuffer->getFramebufferInfo();
+        viewport.pipeline = GetPSO(framebufferInfo, viewport.bindless ? PipelineVariant::Bindless : PipelineVariant::Default, premultiplied);
+        viewport.alpha8Pipeline = viewport.bindless ? viewport.pipeline : GetPSO(framebufferInfo, PipelineVariant::Alpha8, premultiplied);
+        drawState.pipeline = viewport.pipeline;
+        drawState.viewport.viewports.push_back(nvrhi::Viewport(fbWidth, fbHeight));
+        drawState.viewport.scissorRects.resize(1);  // updated below
+
+        nvrhi::VertexBufferBinding vbufBinding;
+        vbufBinding.buffer = geometry.vertexBuffer;
+        vbufBinding.slot = 0;
+        vbufBinding.offset = geometry.vertexOffset;
+        drawState.vertexBuffers.push_back(vbufBinding);
+
+        drawState.indexBuffer.buffer = geometry.indexBuffer;
+        drawState.indexBuffer.format = (sizeof(ImDrawIdx) == 2 ? nvrhi::Format::R16_UINT : nvrhi::Format::R32_UINT);
+        drawState.indexBuffer.offset = geometry.indexOffset;
+
+        const uint32_t drawCommands = BuildBatches(ctx, drawData, geometry, fbWidth, fbHeight, viewport.bindless);
+
+        if (!frameLayerRequests.empty())
+        {
+            viewport.compositePipeline = GetPSO(framebufferInfo, PipelineVariant::Composite);
+            BuildWindowLayers(ctx, drawData, framebufferInfo.colorFormats[0]);
+        }
+
+        ReleaseStaleLayerAtlas(ctx.layers);
+
+        ctx.chunkCount = allowChunks ? GetRecordChunkCount(ctx, drawCommands) : 1;
+    }
+
+    // Replaces the batches of every window that asked for a layer with one composite batch, after redrawing the layers
+    // whose window changed into the atlas. Redraws are recorded here, ahead of every batch of the viewport.
+    void BuildWindowLayers(RenderContext& ctx, ImDrawData* drawData, nvrhi::Format format)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        WindowLayers& wl = ctx.layers;
+        const uint32_t atlasSize = std::max(settings.windowLayerAtlasSize, c_LayerGranularity);
+
+        // windows gone for a while give their regions back at the next repack
+        std::erase_if(wl.layers, [this](const auto& entry) { return entry.second.lastFrame + c_LayerStaleFrames < frameIndex; });
+
+        // find the layers of the frame and what changed
+        wl.frameLists.clear();
+        bool needRegions = false;
+
+        for (int n = 0; n < drawData->CmdListsCount; n++)
+        {
+            const ImDrawList* cmdList = drawData->CmdLists[n];
+            if (!std::binary_search(frameLayerRequests.begin(), frameLayerRequests.end(), cmdList))
+                continue;
+
+            const uint32_t firstBatch = ctx.listFirstBatch[n];
+            const uint32_t endBatch = ctx.listFirstBatch[n + 1];
+            if (firstBatch == endBatch || !CanCacheLayer(cmdList))
+                continue;
+
+            nvrhi::Rect bounds = ctx.batches[firstBatch].scissor;
+            for (uint32_t b = firstBatch + 1; b < endBatch; b++)
+            {
+                const nvrhi::Rect& scissor = ctx.batches[b].scissor;
+                bounds.minX = std::min(bounds.minX, scissor.minX);
+                bounds.maxX = std::max(bounds.maxX, scissor.maxX);
+                bounds.minY = std::min(bounds.minY, scissor.minY);
+                bounds.maxY = std::max(bounds.maxY, scissor.maxY);
+            }
+
+            const uint32_t width = uint32_t(bounds.maxX - bounds.minX);
+            const uint32_t height = uint32_t(bounds.maxY - bounds.minY);
+            if (width > atlasSize || height > atlasSize)
+                continue;
+
+            uint64_t hash = c_HashSeed;
+            HashBytes(hash, &drawData->DisplayPos, sizeof(ImVec2));
+            HashBytes(hash, &drawData->DisplaySize, sizeof(ImVec2));
+            HashBytes(hash, &drawData->FramebufferScale, sizeof(ImVec2));
+            HashBytes(hash, &bounds, sizeof(bounds));
+            for (const ImDrawCmd& cmd : cmdList->CmdBuffer)
+            {
+                const ImTextureID texID = cmd.GetTexID();
+                HashBytes(hash, &cmd.ClipRect, sizeof(ImVec4));
+                HashBytes(hash, &texID, sizeof(texID));
+                HashBytes(hash, &cmd.IdxOffset, sizeof(cmd.IdxOffset));
+                HashBytes(hash, &cmd.ElemCount, sizeof(cmd.ElemCount));
+            }
+            HashBytes(hash, cmdList->VtxBuffer.Data, cmdList->VtxBuffer.size_in_bytes());
+            HashBytes(hash, cmdList->IdxBuffer.Data, cmdList->IdxBuffer.size_in_bytes());
+
+            WindowLayer& layer = wl.layers[cmdList];
+            layer.lastFrame = frameIndex;
+            layer.redraw = !layer.valid || texturesChanged || hash != layer.hash;
+            layer.placed = layer.w >= width && layer.h >= height;
+            layer.hash = hash;
+            layer.bounds = bounds;
+
+            needRegions |= !layer.placed;
+            wl.frameLists.push_back(n);
+        }
+
+        if (wl.frameLists.empty())
+            return;
+
+        wl.lastLayerFrame = frameIndex;
+
+        // a new atlas holds nothing, every layer of the frame gets a region again
+        if (EnsureLayerAtlas(wl, format, atlasSize))
+        {
+            wl.shelves.clear();
+            for (auto& [cmdList, layer] : wl.layers)
+            {
+                layer.w = layer.h = 0;
+                layer.valid = false;
+                layer.placed = false;
+            }
+
+            needRegions = true;
+        }
+
+        // new or grown windows get a region, a full atlas is packed again with this frame's layers first
+        if (needRegions)
+        {
+            bool full = false;
+            for (int n : wl.frameLists)
+            {
+                WindowLayer& layer = wl.layers[drawData->CmdLists[n]];
+                if (layer.placed)
+                    continue;
+
+                layer.placed = AllocateLayerRegion(wl, atlasSize, layer);
+                layer.redraw = true;
+                full |= !layer.placed;
+            }
+
+            if (full)
+            {
+                CORE_PROFILE_SCOPE_NC("Repack Layers", HE_PROFILE_IMGUI);
+
+                wl.shelves.clear();
+                for (auto& [cmdList, layer] : wl.layers)
+                {
+                    layer.w = layer.h = 0;
+                    layer.valid = false;
+                    layer.placed = false;
+                }
+
+                for (int n : wl.frameLists)
+                {
+                    WindowLayer& layer = wl.layers[drawData->CmdLists[n]];
+                    layer.placed = AllocateLayerRegion(wl, atlasSize, layer);
+                    layer.redraw = true;
+                }
+            }
+        }
+
+        // redraw the changed layers
+        nvrhi::ICommandList* commandList = ctx.commandList;
+        const ViewportState& viewport = ctx.viewport;
+        const nvrhi::FramebufferInfo& atlasInfo = wl.framebuffer->getFramebufferInfo();
+        const float fbWidth = viewport.drawState.viewport.viewports[0].width();
+        const float fbHeight = viewport.drawState.viewport.viewports[0].height();
+        const float atlasExtent = float(atlasSize);
+
+        ViewportState layerViewport;
+        layerViewport.bindless = viewport.bindless;
+        layerViewport.pipeline = GetPSO(atlasInfo, viewport.bindless ? PipelineVariant::Bindless : PipelineVariant::Default, true);
+        layerViewport.alpha8Pipeline = viewport.bindless ? layerViewport.pipeline : GetPSO(atlasInfo, PipelineVariant::Alpha8, true);
+        layerViewport.drawState = viewport.drawState;
+        layerViewport.drawState.pipeline = layerViewport.pipeline;
+        layerViewport.drawState.framebuffer = wl.framebuffer;
+        layerViewport.drawState.viewport = nvrhi::ViewportState().addViewportAndScissorRect(nvrhi::Viewport(atlasExtent, atlasExtent));
+
+        nvrhi::GraphicsState clearState;
+        clearState.pipeline = GetPSO(atlasInfo, PipelineVariant::LayerClear);
+        clearState.framebuffer = wl.framebuffer;
+        clearState.viewport = layerViewport.drawState.viewport;
+
+        for (int n : wl.frameLists)
+        {
+            WindowLayer& layer = wl.layers[drawData->CmdLists[n]];
+            if (!layer.placed || !layer.redraw)
+                continue;
+
+            const int dx = int(layer.x) - layer.bounds.minX;
+            const int dy = int(layer.y) - layer.bounds.minY;
+
+            clearState.viewport.scissorRects[0] = nvrhi::Rect(int(layer.x), int(layer.x + layer.w), int(layer.y), int(layer.y + layer.h));
+            commandList->setGraphicsState(clearState);
+            commandList->draw(nvrhi::DrawArguments().setVertexCount(3));
+
+            // the same projection, shifted by the window's offset into the atlas
+            PushConstants& pushConstants = layerViewport.pushConstants;
+            pushConstants = viewport.pushConstants;
+            pushConstants.scale.x *= fbWidth / atlasExtent;
+            pushConstants.scale.y *= fbHeight / atlasExtent;
+            pushConstants.translate.x = viewport.pushConstants.translate.x * fbWidth / atlasExtent + (fbWidth + 2.0f * dx) / atlasExtent - 1.0f;
+            pushConstants.translate.y = viewport.pushConstants.translate.y * fbHeight / atlasExtent + (fbHeight + 2.0f * dy) / atlasExtent - 1.0f;
+
+            wl.scratch.assign(ctx.batches.begin() + ctx.listFirstBatch[n], ctx.batches.begin() + ctx.listFirstBatch[n + 1]);
+            for (DrawBatch& batch : wl.scratch)
+            {
+                batch.scissor.minX += dx;
+                batch.scissor.maxX += dx;
+                batch.scissor.minY += dy;
+                batch.scissor.maxY += dy;
+            }
+
+            HEImGui::FrameStats layerStats;
+            RecordBatches(commandList, layerViewport, wl.scratch.data(), wl.scratch.data() + wl.scratch.size(), layerStats);
+            stats.drawCalls += layerStats.drawCalls + 1;
+            stats.stateChanges += layerStats.stateChanges + 1;
+            stats.pushConstantUpdates += layerStats.pushConstantUpdates;
+
+            layer.valid = true;
+            stats.windowLayerRedraws++;
+        }
+
+        // swap the windows' batches for their composite
+        nvrhi::IBindingSet* atlasBindings = GetBindingSet(wl.atlas);
+        std::vector<DrawBatch>& batches = wl.scratch;
+        batches.clear();
+
+        size_t nextLayer = 0;
+        for (int n = 0; n < drawData->CmdListsCount; n++)
+        {
+            const bool isLayer = nextLayer < wl.frameLists.size() && wl.frameLists[nextLayer] == n;
+            if (isLayer)
+                nextLayer++;
+
+            const WindowLayer* layer = isLayer ? &wl.layers[drawData->CmdLists[n]] : nullptr;
+            if (!layer || !layer->placed)
+            {
+                batches.insert(batches.end(), ctx.batches.begin() + ctx.listFirstBatch[n], ctx.batches.begin() + ctx.listFirstBatch[n + 1]);
+                continue;
+            }
+
+            DrawBatch& batch = batches.emplace_back();
+            batch.cmdList = drawData->CmdLists[n];
+            batch.bindings = atlasBindings;
+            batch.scissor = layer->bounds;
+            batch.layer = true;
+            batch.layerOffsetX = int(layer->x) - layer->bounds.minX;
+            batch.layerOffsetY = int(layer->y) - layer->bounds.minY;
+
+            stats.windowLayers++;
+        }
+
+        ctx.batches.swap(batches);
+    }
+
+    // Layers can't replay user callbacks, nor notice user textures changing
+    bool CanCacheLayer(const ImDrawList* cmdList) const
+    {
+        for (const ImDrawCmd& cmd : cmdList->CmdBuffer)
+        {
+            if (cmd.UserCallback)
+                return false;
+
+            if (!cmd.TexRef._TexData && !settings.uiCacheStaticUserTextures)
+                return false;
+        }
+
+        return true;
+    }
+
+    // Shelf packing, a region is placed on the lowest shelf it fits on, rounded up so small resizes stay in place
+    static bool AllocateLayerRegion(WindowLayers& wl, uint32_t atlasSize, WindowLayer& layer)
+    {
+        const uint32_t w = (uint32_t(layer.bounds.maxX - layer.bounds.minX) + c_LayerGranularity - 1) / c_LayerGranularity * c_LayerGranularity;
+        const uint32_t h = (uint32_t(layer.bounds.maxY - layer.bounds.minY) + c_LayerGranularity - 1) / c_LayerGranularity * c_LayerGranularity;
+
+        LayerShelf* best = nullptr;
+        for (LayerShelf& shelf : wl.shelves)
+            if (shelf.height >= h && shelf.x + w <= atlasSize && (!best || shelf.height < best->height))
+                best = &shelf;
+
+        if (!best)
+        {
+            const uint32_t top = wl.shelves.empty() ? 0 : wl.shelves.back().y + wl.shelves.back().height;
+            if (top + h > atlasSize || w > atlasSize)
+                return false;
+
+            best = &wl.shelves.emplace_back(LayerShelf{ top, h, 0 });
+        }
+
+        layer.x = best->x;
+        layer.y = best->y;
+        layer.w = w;
+        layer.h = h;
+        layer.valid = false;
+        best->x += w;
+
+        return true;
+    }
+
+    // (Re)creates the atlas for the viewport's format, returns true when it did
+    bool EnsureLayerAtlas(WindowLayers& wl, nvrhi::Format format, uint32_t atlasSize)
+    {
+        if (wl.atlas)
+        {
+            const nvrhi::TextureDesc& desc = wl.atlas->getDesc();
+            if (desc.format == format && desc.width == atlasSize)
+                return false;
+        }
+
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        DeferRelease(wl.framebuffer);
+        DeferRelease(wl.atlas);
+
+        nvrhi::TextureDesc desc;
+        desc.width = atlasSize;
+        desc.height = atlasSize;
+        desc.format = format;
+        desc.isRenderTarget = true;
+        desc.initialState = nvrhi::ResourceStates::ShaderResource;
+        desc.keepInitialState = true;
+        desc.debugName = "ImGui Window Layers";
+
+        wl.atlas = device->createTexture(desc);
+        CORE_ASSERT(wl.atlas);
+
+        wl.framebuffer = device->createFramebuffer(nvrhi::FramebufferDesc().addColorAttachment(wl.atlas));
+
+        const nvrhi::FramebufferInfo& atlasInfo = wl.framebuffer->getFramebufferInfo();
+        PrewarmPipelines(atlasInfo, true);
+        if (!FindPSO(atlasInfo, PipelineVariant::LayerClear))
+            CreatePSO(atlasInfo, PipelineVariant::LayerClear);
+
+        return true;
+    }
+
+    // A viewport whose windows stopped asking for layers gives the atlas memory back
+    void ReleaseStaleLayerAtlas(WindowLayers& wl)
+    {
+        if (!wl.atlas || wl.lastLayerFrame + c_LayerStaleFrames >= frameIndex)
+            return;
+
+        DeferRelease(wl.framebuffer);
+        DeferRelease(wl.atlas);
+        wl.framebuffer = nullptr;
+        wl.atlas = nullptr;
+        wl.shelves.clear();
+        wl.layers.clear();
+    }
+
+    // A window's layer as one full-screen triangle scissored to the window
+    static void RecordLayerComposite(nvrhi::ICommandList* cl, const ViewportState& viewport, const DrawBatch& batch, HEImGui::FrameStats& recordStats)
+    {
+        nvrhi::GraphicsState state;
+        state.pipeline = viewport.compositePipeline;
+        state.framebuffer = viewport.drawState.framebuffer;
+        state.bindings = { batch.bindings };
+        state.viewport.viewports = viewport.drawState.viewport.viewports;
+        state.viewport.scissorRects = { batch.scissor };
+        cl->setGraphicsState(state);
+
+        PushConstants constants;
+        constants.translate = ImVec2(float(batch.layerOffsetX), float(batch.layerOffsetY));
+        cl->setPushConstants(&constants, sizeof(PushConstants));
+
+        cl->draw(nvrhi::DrawArguments().setVertexCount(3));
+
+        recordStats.stateChanges++;
+        recordStats.bindingChanges++;
+        recordStats.pushConstantUpdates++;
+        recordStats.drawCalls++;
+    }
+
+    // Any thread: records the prepared batches, writing nothing outside the context
+    void RecordViewport(RenderContext& ctx)
+    {
+        ctx.recordStats = {};
+
+        const auto recordStart = std::chrono::steady_clock::now();
+
+        if (ctx.chunkCount > 1)
+            RecordParallel(ctx);
+        else
+            RecordBatches(ctx.commandList, ctx.viewport, ctx.batches.data(), ctx.batches.data() + ctx.batches.size(), ctx.recordStats);
+
+        ctx.recordStats.recordMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - recordStart).count();
+        ctx.recordStats.recordChunks = ctx.chunkCount;
+    }
+
+    void MergeRecordStats(const RenderContext& ctx)
+    {
+        const HEImGui::FrameStats& recorded = ctx.recordStats;
+        stats.drawCalls += recorded.drawCalls;
+        stats.stateChanges += recorded.stateChanges;
+        stats.bindingChanges += recorded.bindingChanges;
+        stats.scissorChanges += recorded.scissorChanges;
+        stats.pushConstantUpdates += recorded.pushConstantUpdates;
+        stats.recordChunks += recorded.recordChunks;
+        stats.recordMicroseconds += recorded.recordMicroseconds;
+
+        if (settings.parallelRecordBenchmark)
+            AddRecordBenchmarkSample(ctx.batches.size(), ctx.chunkCount > 1, recorded.recordMicroseconds);
+    }
+
+    // One executeCommandLists for all contexts. Chunks follow their context's main list, which carries the geometry upload.
+    void Submit(RenderContext* const* contexts, uint32_t count)
+    {
+        submitCommandLists.clear();
+
+        // texture updates go first so every viewport samples the updated texels
+        if (textureCommandListOpen)
+        {
+            textureCommandList->endMarker();
+            textureCommandList->close();
+            textureCommandListOpen = false;
+            submitCommandLists.push_back(textureCommandList);
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const RenderContext& ctx = *contexts[i];
+
+            submitCommandLists.push_back(ctx.commandList);
+            for (uint32_t chunk = 1; chunk < ctx.chunkCount; chunk++)
+                submitCommandLists.push_back(ctx.chunkCommandLists[chunk - 1]);
+        }
+
+        device->executeCommandLists(submitCommandLists.data(), submitCommandLists.size());
+
+        // the last submission of the frame is what the fence ends up waiting for
+        FrameSlot& frame = CurrentFrame();
+        device->resetEventQuery(frame.fence);
+        device->setEventQuery(frame.fence, nvrhi::CommandQueue::Graphics);
+        frame.fencePending = true;
+        frame.frame = frameIndex;
+    }
+
+    // Frames that render nothing still apply ImGui's texture requests, so its textures don't fall behind
+    void SubmitTextures()
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        UpdateTextures();
+
+        if (textureCommandListOpen)
+            Submit(nullptr, 0);
+    }
+
+    FrameSlot& CurrentFrame() { return frames[frameIndex % c_FramesInFlight]; }
+
+    void RetireFrame(FrameSlot& slot)
+    {
+        slot.fencePending = false;
+        completedFrame = std::max(completedFrame, slot.frame);
+    }
+
+    // Frames without a submission retire with the next fence that completes after them
+    void ReleaseRetired()
+    {
+        while (!deferredReleases.empty() && deferredReleases.front().frame <= completedFrame)
+            deferredReleases.pop_front();
+
+        stats.pendingReleases = uint32_t(deferredReleases.size());
+    }
+
+    // Records batches [begin, end) into 'cl'. Touches nothing shared but 'recordStats', so chunks can be recorded concurrently.
+    void RecordBatches(nvrhi::ICommandList* cl, const ViewportState& viewport, const DrawBatch* begin, const DrawBatch* end, HEImGui::FrameStats& recordStats)
+    {
+        nvrhi::GraphicsState drawState = viewport.drawState;
+        PushConstants pushConstants = viewport.pushConstants;
+        const bool bindless = viewport.bindless;
+
+        StateTracker tracker;
+        for (const DrawBatch* it = begin; it != end; ++it)
+        {
+            const DrawBatch& batch = *it;
+
+            if (batch.callback)
+            {
+                if (batch.callback->UserCallback == ImDrawCallback_ResetRenderState)
+                    tracker = {};
+                else
+                    batch.callback->UserCallback(batch.cmdList, batch.callback);
+                continue;
+            }
+
+            if (batch.layer)
+            {
+                // everything is set again for the next draw, the local constants still hold the last texture index
+                RecordLayerComposite(cl, viewport, batch, recordStats);
+                tracker = {};
+                tracker.textureIndex = pushConstants.textureIndex;
+                continue;
+            }
+
+            nvrhi::IBindingSet* bindings = batch.bindings;
+            CORE_ASSERT(bindings);
+
+            if (bindless && batch.textureIndex != tracker.textureIndex)
+            {
+                pushConstants.textureIndex = batch.textureIndex;
+                tracker.textureIndex = batch.textureIndex;
+                tracker.constantsValid = false;
+            }
+
+            // bindless draws pick the texel format in the shader, the others switch pipelines
+            bool pipelineChanged = false;
+            if (batch.alpha8 != tracker.alpha8 || !tracker.stateValid)
+            {
+                if (bindless)
+                {
+                    pushConstants.alpha8 = batch.alpha8;
+                    tracker.constantsValid = false;
+                }
+                else
+                {
+                    nvrhi::IGraphicsPipeline* pipeline = batch.alpha8 ? viewport.alpha8Pipeline : viewport.pipeline;
+                    pipelineChanged = drawState.pipeline != pipeline;
+                    drawState.pipeline = pipeline;
+                }
+
+                tracker.alpha8 = batch.alpha8;
+            }
+
+            // nvrhi has no scissor-only entry point, but setGraphicsState diffs against the previous state,
+            // so leaving every other field untouched makes a scissor change re-emit only the scissor rect.
+            const bool bindingsChanged = !tracker.stateValid || bindings != tracker.bindings;
+            const bool scissorChanged = !tracker.stateValid || batch.scissor != tracker.scissor;
+            if (bindingsChanged || scissorChanged || pipelineChanged)
+            {
+                if (bindingsChanged)
+                {
+                    if (bindless)
+                        drawState.bindings = { bindings, descriptorTable };
+                    else
+                        drawState.bindings = { bindings };
+                    recordStats.bindingChanges++;
+                }
+
+                if (scissorChanged)
+                {
+                    drawState.viewport.scissorRects[0] = batch.scissor;
+                    recordStats.scissorChanges++;
+                }
+
+                cl->setGraphicsState(drawState);
+                recordStats.stateChanges++;
+
+                // a pipeline switch may drop the constants
+                if (pipelineChanged)
+                    tracker.constantsValid = false;
+
+                tracker.bindings = bindings;
+                tracker.scissor = batch.scissor;
+                tracker.stateValid = true;
+            }
+
+            // the binding layout is the same for the whole viewport, so the constants survive binding and scissor changes,
+            // only the bindless texture index and format make them change between draws
+            if (!tracker.constantsValid)
+            {
+                cl->setPushConstants(&pushConstants, sizeof(PushConstants));
+                recordStats.pushConstantUpdates++;
+                tracker.constantsValid = true;
+            }
+
+            nvrhi::DrawArguments drawArguments;
+            drawArguments.vertexCount = batch.indexCount;
+            drawArguments.startIndexLocation = batch.startIndex;
+            drawArguments.startVertexLocation = batch.startVertex;
+            cl->drawIndexed(drawArguments);
+
+            recordStats.drawCalls++;
+        }
+    }
+
+    uint32_t GetRecordChunkCount(const RenderContext& ctx, uint32_t drawCommands)
+    {
+        const std::vector<DrawBatch>& batches = ctx.batches;
+
+        // D3D11 records on the immediate context, and user callbacks expect to run in draw order on this thread
+        if (device->getGraphicsAPI() == nvrhi::GraphicsAPI::D3D11 || ctx.batchesHaveCallbacks || settings.parallelRecordMaxThreads == 0)
+            return 1;
+
+        const uint32_t maxChunks = settings.parallelRecordMaxThreads + 1;
+
+        // the benchmark alternates both modes on every viewport, whatever its size
+        if (settings.parallelRecordBenchmark)
+            return (frameIndex & 1) ? std::clamp(uint32_t(batches.size()), 1u, maxChunks) : 1;
+
+        if (settings.parallelRecordThreshold == 0 || drawCommands < settings.parallelRecordThreshold)
+            return 1;
+
+        const uint32_t chunks = uint32_t(batches.size() / std::max(settings.parallelRecordMinBatchesPerChunk, 1u));
+        return std::clamp(chunks, 1u, maxChunks);
+    }
+
+    // Chunk 0 is recorded here into the context's command list behind the geometry upload, the others on worker threads into their own lists
+    void RecordParallel(RenderContext& ctx)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        const uint32_t chunkCount = ctx.chunkCount;
+
+        workers.Start(chunkCount - 1);
+
+        while (ctx.chunkCommandLists.size() < chunkCount - 1)
+            ctx.chunkCommandLists.push_back(device->createCommandList());
+
+        ctx.chunkStats.assign(chunkCount, {});
+
+        const size_t batchCount = ctx.batches.size();
+        workers.ParallelFor(chunkCount, [&](uint32_t chunk) {
+
+            const DrawBatch* begin = ctx.batches.data() + batchCount * chunk / chunkCount;
+            const DrawBatch* end = ctx.batches.data() + batchCount * (chunk + 1) / chunkCount;
+
+            if (chunk == 0)
+            {
+                RecordBatches(ctx.commandList, ctx.viewport, begin, end, ctx.chunkStats[chunk]);
+                return;
+            }
+
+            nvrhi::ICommandList* cl = ctx.chunkCommandLists[chunk - 1];
+            cl->open();
+            cl->beginMarker("ImGui");
+            RecordBatches(cl, ctx.viewport, begin, end, ctx.chunkStats[chunk]);
+            cl->endMarker();
+            cl->close();
+        });
+
+        for (const HEImGui::FrameStats& chunk : ctx.chunkStats)
+        {
+            ctx.recordStats.drawCalls += chunk.drawCalls;
+            ctx.recordStats.stateChanges += chunk.stateChanges;
+            ctx.recordStats.bindingChanges += chunk.bindingChanges;
+            ctx.recordStats.scissorChanges += chunk.scissorChanges;
+            ctx.recordStats.pushConstantUpdates += chunk.pushConstantUpdates;
+        }
+    }
+
+    void AddRecordBenchmarkSample(size_t batchCount, bool parallel, double microseconds)
+    {
+        RecordBenchmark& bench = recordBenchmark;
+
+        uint32_t bucketIndex = 0;
+        while ((size_t(2) << bucketIndex) <= batchCount && bucketIndex + 1 < bench.buckets.size())
+            bucketIndex++;
+
+        RecordBenchmark::Bucket& bucket = bench.buckets[bucketIndex];
+        if (parallel)
+        {
+            bucket.parallelMicroseconds += microseconds;
+            bucket.parallelSamples++;
+        }
+        else
+        {
+            bucket.singleMicroseconds += microseconds;
+            bucket.singleSamples++;
+        }
+
+        if (++bench.samples < 600)
+            return;
+
+        // the crossover is the smallest draw count from which parallel recording is faster
+        LOG_INFO("[HEImGui] Record benchmark ({} worker threads), average recording time per viewport:", settings.parallelRecordMaxThreads);
+
+        uint32_t crossover = 0;
+        for (uint32_t i = 0; i < bench.buckets.size(); i++)
+        {
+            const RecordBenchmark::Bucket& b = bench.buckets[i];
+            if (b.singleSamples == 0 || b.parallelSamples == 0)
+                continue;
+
+            const double single = b.singleMicroseconds / b.singleSamples;
+            const double multi = b.parallelMicroseconds / b.parallelSamples;
+            LOG_INFO("[HEImGui]   {:>6} - {:>6} batches : single {:>9.1f} us, parallel {:>9.1f} us", 1u << i, (2u << i) - 1, single, multi);
+
+            if (multi < single && crossover == 0)
+                crossover = 1u << i;
+        }
+
+        if (crossover)
+            LOG_INFO("[HEImGui]   parallel recording wins from ~{} draw batches", crossover);
+        else
+            LOG_INFO("[HEImGui]   parallel recording never won");
+
+        bench = {};
+    }
+
+    void NewFrame()
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        stats = {};
+        frameIndex++;
+
+        // wait until the GPU is done with the frame that used this slot last
+        FrameSlot& frame = CurrentFrame();
+        if (frame.fencePending)
+        {
+            device->waitEventQuery(frame.fence);
+            RetireFrame(frame);
+        }
+
+        // the other slots are only polled, their frames may have finished early
+        for (FrameSlot& slot : frames)
+            if (slot.fencePending && device->pollEventQuery(slot.fence))
+                RetireFrame(slot);
+
+        ReleaseRetired();
+        texturesChanged = false;
+
+        frameLayerRequests.swap(windowLayerRequests);
+        windowLayerRequests.clear();
+        std::sort(frameLayerRequests.begin(), frameLayerRequests.end());
+
+        EvictTextureBindings();
+        PrewarmConfiguredPipelines();
+
+        if (settings.bindlessTextures && !bindlessTableCreated)
+            CreateDescriptorTable();
+    }
+
+    // Sized once from Settings::bindlessTextureCapacity, before any command list of the frame is recorded.
+    // Devices without descriptor indexing fail the layout and keep using one binding set per texture.
+    void CreateDescriptorTable()
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        bindlessTableCreated = true;
+        if (!bindlessBindingSet)
+            return;
+
+        bindlessCapacity = std::max(settings.bindlessTextureCapacity, 1u);
+
+        nvrhi::BindlessLayoutDesc bindlessDesc;
+        bindlessDesc.visibility = nvrhi::ShaderType::Pixel;
+        bindlessDesc.firstSlot = 0;
+        bindlessDesc.maxCapacity = bindlessCapacity;
+        bindlessDesc.registerSpaces = { nvrhi::BindingLayoutItem::Texture_SRV(1) };
+        bindlessLayout = device->createBindlessLayout(bindlessDesc);
+        if (!bindlessLayout)
+            return;
+
+        descriptorTable = device->createDescriptorTable(bindlessLayout);
+        device->resizeDescriptorTable(descriptorTable, bindlessCapacity, false);
+
+        bindlessPSODesc = basePSODesc;
+        bindlessPSODesc.PS = bindlessPixelShader;
+        bindlessPSODesc.bindingLayouts = { bindlessBindingLayout, bindlessLayout };
+
+        // every layout compiled so far gets its bindless variant now rather than on the render path
+        const size_t count = pipelines.size();
+        for (size_t i = 0; i < count; i++)
+        {
+            const CachedPipeline cached = pipelines[i];
+            if (cached.variant == PipelineVariant::Default && !FindPSO(cached.framebufferInfo, PipelineVariant::Bindless, cached.premultiplied))
+                CreatePSO(cached.framebufferInfo, PipelineVariant::Bindless, cached.premultiplied);
+        }
+    }
+
+    // Flattens the draw lists into draw batches, merging adjacent commands that can be issued as one drawIndexed.
+    // Returns the number of draw commands found in the draw data.
+    uint32_t BuildBatches(RenderContext& ctx, ImDrawData* drawData, const GeometryRange& geometry, float fbWidth, float fbHeight, bool bindless)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        std::vector<DrawBatch>& batches = ctx.batches;
+        batches.clear();
+        ctx.batchesHaveCallbacks = false;
+        ctx.listFirstBatch.clear();
+        uint32_t drawCommands = 0;
+
+        // Will project scissor/clipping rectangles into framebuffer space
+        ImVec2 clipOff = drawData->DisplayPos;         // (0,0) unless using multi-viewports
+        ImVec2 clipScale = drawData->FramebufferScale; // (1,1) unless using retina display which are often (2,2)
+
+        int vtxOffset = 0;
+        int idxOffset = 0;
+        for (int n = 0; n < drawData->CmdListsCount; n++)
+        {
+            const ImDrawList* cmdList = drawData->CmdLists[n];
+            const size_t firstBatch = batches.size();
+            ctx.listFirstBatch.push_back(uint32_t(firstBatch));
+
+            if (geometry.lists)
+            {
+                vtxOffset = int(geometry.lists[n].vertexStart);
+                idxOffset = int(geometry.lists[n].indexStart);
+            }
+
+            for (int i = 0; i < cmdList->CmdBuffer.Size; i++)
+            {
+                const ImDrawCmd* pCmd = &cmdList->CmdBuffer[i];
+
+                if (pCmd->UserCallback)
+                {
+                    DrawBatch& batch = batches.emplace_back();
+                    batch.cmdList = cmdList;
+                    batch.callback = pCmd;
+                    ctx.batchesHaveCallbacks |= pCmd->UserCallback != ImDrawCallback_ResetRenderState;
+                    continue;
+                }
+
+                drawCommands++;
+
+                ImVec2 clipMin((pCmd->ClipRect.x - clipOff.x) * clipScale.x, (pCmd->ClipRect.y - clipOff.y) * clipScale.y);
+                ImVec2 clipMax((pCmd->ClipRect.z - clipOff.x) * clipScale.x, (pCmd->ClipRect.w - clipOff.y) * clipScale.y);
+
+                if (clipMin.x < 0.0f) { clipMin.x = 0.0f; }
+                if (clipMin.y < 0.0f) { clipMin.y = 0.0f; }
+                if (clipMax.x > fbWidth) { clipMax.x = (float)fbWidth; }
+                if (clipMax.y > fbHeight) { clipMax.y = (float)fbHeight; }
+                if (clipMax.x <= clipMin.x || clipMax.y <= clipMin.y) continue;
+
+                DrawBatch batch;
+                batch.texture = (nvrhi::ITexture*)pCmd->GetTexID();
+                batch.bindings = bindless ? bindlessBindingSet.Get() : GetBindingSet(batch.texture);
+                batch.textureIndex = bindless ? GetBindlessIndex(batch.texture) : 0;
+                // only textures ImGui asked for as Alpha8, an R8 user texture is drawn like any other
+                batch.alpha8 = pCmd->TexRef._TexData && pCmd->TexRef._TexData->Format == ImTextureFormat_Alpha8;
+                batch.scissor = nvrhi::Rect((int)clipMin.x, (int)clipMax.x, (int)clipMin.y, (int)clipMax.y);
+                batch.indexCount = pCmd->ElemCount;
+                batch.startIndex = pCmd->IdxOffset + idxOffset;
+                batch.startVertex = pCmd->VtxOffset + vtxOffset;
+
+                // Clip rects are compared after projection and clamping, so commands whose rects only
+                // differ outside the framebuffer still merge. A containing rect is not enough on its own:
+                // ImGui only clips coarsely on the CPU and relies on the scissor for the rest.
+                if (settings.mergeDrawCommands && batches.size() > firstBatch)
+                {
+                    DrawBatch& prev = batches.back();
+                    if (!prev.callback &&
+                        prev.texture == batch.texture &&
+                        prev.scissor == batch.scissor &&
+                        prev.startVertex == batch.startVertex &&
+                        prev.startIndex + prev.indexCount == batch.startIndex)
+                    {
+                        prev.indexCount += batch.indexCount;
+                        stats.mergedDrawCalls++;
+                        continue;
+                    }
+                }
+
+                batches.push_back(batch);
+            }
+
+            idxOffset += cmdList->IdxBuffer.Size;
+            vtxOffset += cmdList->VtxBuffer.Size;
+        }
+
+        ctx.listFirstBatch.push_back(uint32_t(batches.size()));
+
+        stats.drawCommands += drawCommands;
+        return drawCommands;
+    }
+
+    // Capacity for 'requiredSize' bytes: geometric growth for headroom, clamped to the configured range.
+    // A frame larger than the maximum still gets exactly what it needs.
+    size_t GrowCapacity(const GeometryBuffer& gb, size_t requiredSize) const
+    {
+        const size_t elementSize = gb.ElementSize();
+        const size_t minSize = size_t(settings.minBufferElements) * elementSize;
+        const size_t maxSize = std::max(size_t(settings.maxBufferElements) * elementSize, minSize);
+
+        const float growth = std::max(settings.bufferGrowthFactor, 1.0f);
+
+        size_t size = std::max(size_t(float(requiredSize) * growth), size_t(float(gb.Capacity()) * growth));
+        size = std::clamp(size, minSize, maxSize);
+        size = std::max(size, requiredSize);
+
+        return (size + elementSize - 1) / elementSize * elementSize;
+    }
+
+    bool ReallocateBuffer(GeometryBuffer& gb, size_t requiredSize)
+    {
+        gb.peakBytes = std::max(gb.peakBytes, requiredSize);
+
+        if (gb.buffer != nullptr && gb.Capacity() >= requiredSize)
+            return true;
+
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        const size_t byteSize = GrowCapacity(gb, requiredSize);
+
+        if (gb.buffer)
+        {
+            totals.bufferGrowths++;
+            ReleaseBuffer(gb);
+        }
+
+        nvrhi::BufferDesc desc;
+        desc.byteSize = uint32_t(byteSize);
+        desc.structStride = 0;
+        desc.debugName = gb.isIndexBuffer ? "ImGui index buffer" : "ImGui vertex buffer";
+        desc.cpuAccess = gb.cpuVisible ? nvrhi::CpuAccessMode::Write : nvrhi::CpuAccessMode::None;
+        desc.canHaveUAVs = false;
+        desc.isVertexBuffer = !gb.isIndexBuffer;
+        desc.isIndexBuffer = gb.isIndexBuffer;
+        desc.isDrawIndirectArgs = false;
+        desc.isVolatile = false;
+        desc.initialState = gb.isIndexBuffer ? nvrhi::ResourceStates::IndexBuffer : nvrhi::ResourceStates::VertexBuffer;
+        desc.keepInitialState = true;
+
+        gb.buffer = device->createBuffer(desc);
+
+        if (!gb.buffer)
+        {
+            return false;
+        }
+
+        if (gb.cpuVisible)
+        {
+            gb.mapped = (uint8_t*)device->mapBuffer(gb.buffer, nvrhi::CpuAccessMode::Write);
+            if (!gb.mapped)
+                return false;
+        }
+
+        gb.quietFrames = 0;
+        return true;
+    }
+
+    // Frames in flight may still read the buffer, it is only unmapped here and released once they retire
+    void ReleaseBuffer(GeometryBuffer& gb)
+    {
+        if (gb.mapped)
+            device->unmapBuffer(gb.buffer);
+
+        DeferRelease(gb.buffer);
+        gb.mapped = nullptr;
+        gb.buffer = nullptr;
+    }
+
+    // Drops the buffer once its peak use stayed below capacity / growth^2 for 'bufferShrinkFrames' checks,
+    // the next use reallocates it at peak * growth. The gap between the two thresholds is the hysteresis
+    // that keeps a buffer from bouncing between sizes.
+    bool ShrinkIfQuiet(GeometryBuffer& gb)
+    {
+        const size_t peak = gb.peakBytes;
+        gb.peakBytes = 0;
+
+        if (!gb.buffer)
+            return false;
+
+        const float growth = std::max(settings.bufferGrowthFactor, 1.0f);
+        const size_t shrinkThreshold = size_t(float(gb.Capacity()) / (growth * growth));
+        const size_t minSize = size_t(settings.minBufferElements) * gb.ElementSize();
+
+        if (peak >= shrinkThreshold || gb.Capacity() <= minSize)
+        {
+            gb.quietFrames = 0;
+            return false;
+        }
+
+        if (++gb.quietFrames < settings.bufferShrinkFrames)
+            return false;
+
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        ReleaseBuffer(gb);
+        totals.bufferShrinks++;
+        gb.quietFrames = 0;
+
+        return true;
+    }
+
+    static uint32_t RectArea(const ImTextureRect& r) { return uint32_t(r.w) * r.h; }
+
+    static ImTextureRect RectUnion(const ImTextureRect& a, const ImTextureRect& b)
+    {
+        const int x0 = std::min(a.x, b.x);
+        const int y0 = std::min(a.y, b.y);
+        const int x1 = std::max(a.x + a.w, b.x + b.w);
+        const int y1 = std::max(a.y + a.h, b.y + b.h);
+
+        return { (unsigned short)x0, (unsigned short)y0, (unsigned short)(x1 - x0), (unsigned short)(y1 - y0) };
+    }
+
+    // Greedily merges rect pairs while uploading their union is cheaper than two copies. ImGui produces a handful
+    // of rects per frame, one per baked glyph or so, so the quadratic pass stays cheap.
+    static void CoalesceRects(std::vector<ImTextureRect>& rects)
+    {
+        bool merged = true;
+        while (merged && rects.size() > 1)
+        {
+            merged = false;
+            for (size_t i = 0; i < rects.size() && !merged; i++)
+            {
+                for (size_t j = i + 1; j < rects.size(); j++)
+                {
+                    const ImTextureRect joined = RectUnion(rects[i], rects[j]);
+                    if (RectArea(joined) > RectArea(rects[i]) + RectArea(rects[j]) + c_TextureCopyCostTexels)
+                        continue;
+
+                    rects[i] = joined;
+                    rects[j] = rects.back();
+                    rects.pop_back();
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Shelf-packs uploads [begin, end) into a 'width' wide page, in their current order. Returns the height used.
+    static uint32_t PackTextureUploads(TextureUpload* begin, TextureUpload* end, uint32_t width)
+    {
+        uint32_t x = 0;
+        uint32_t y = 0;
+        uint32_t shelfHeight = 0;
+
+        for (TextureUpload* upload = begin; upload != end; ++upload)
+        {
+            if (x + upload->w > width)
+            {
+                y += shelfHeight;
+                x = 0;
+                shelfHeight = 0;
+            }
+
+            upload->stagingX = x;
+            upload->stagingY = y;
+            x += upload->w;
+            shelfHeight = std::max(shelfHeight, upload->h);
+        }
+
+        return y + shelfHeight;
+    }
+
+    // Copies every pending upload into the current frame's staging page with one map, then records the region copies
+    void FlushTextureUploads()
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        if (!textureUploads.empty())
+            FlushStagingUploads();
+
+        nvrhi::ICommandList* commandList = GetTextureCommandList();
+        for (const TextureCopy& copy : textureCopies)
+        {
+            nvrhi::TextureSlice slice = { .x = copy.x, .y = copy.y, .width = copy.w, .height = copy.h };
+            commandList->copyTexture(copy.dst, slice, copy.src, slice);
+            stats.textureCopyTexels += copy.w * copy.h;
+        }
+
+        textureCopies.clear();
+    }
+
+    // One staging page per texel format, the uploads of each format packed tallest first
+    void FlushStagingUploads()
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        std::sort(textureUploads.begin(), textureUploads.end(), [](const TextureUpload& a, const TextureUpload& b) {
+            return a.bytesPerPixel != b.bytesPerPixel ? a.bytesPerPixel > b.bytesPerPixel : a.h > b.h;
+        });
+
+        TextureUpload* uploads = textureUploads.data();
+        const size_t count = textureUploads.size();
+
+        for (size_t begin = 0, end = 0; begin < count; begin = end)
+        {
+            const uint32_t bytesPerPixel = uploads[begin].bytesPerPixel;
+            while (end < count && uploads[end].bytesPerPixel == bytesPerPixel)
+                end++;
+
+            FlushStagingPage(bytesPerPixel, uploads + begin, uploads + end);
+        }
+
+        stats.textureUploads += uint32_t(count);
+        textureUploads.clear();
+    }
+
+    // Copies uploads [begin, end) into the current frame's staging page for their format with one map, then records the region copies
+    void FlushStagingPage(uint32_t bytesPerPixel, TextureUpload* begin, TextureUpload* end)
+    {
+        const bool alpha8 = bytesPerPixel == 1;
+        StagingPage& page = CurrentFrame().staging[alpha8 ? 1 : 0];
+
+        uint32_t width = std::max(page.width, c_MinStagingPageSize);
+        for (const TextureUpload* upload = begin; upload != end; ++upload)
+            width = std::max(width, std::bit_ceil(upload->w));
+
+        const uint32_t height = PackTextureUploads(begin, end, width);
+
+        // the page only grows, a frame's updates are bounded by the size of the atlases anyway
+        if (!page.texture || width > page.width || height > page.height)
+        {
+            DeferRelease(page.texture);
+
+            nvrhi::TextureDesc desc;
+            desc.width = width;
+            desc.height = std::max(std::bit_ceil(height), std::max(page.height, c_MinStagingPageSize));
+            desc.format = alpha8 ? nvrhi::Format::R8_UNORM : nvrhi::Format::RGBA8_UNORM;
+            desc.debugName = "ImGui staging page";
+
+            page.texture = device->createStagingTexture(desc, nvrhi::CpuAccessMode::Write);
+            CORE_ASSERT(page.texture);
+            page.width = desc.width;
+            page.height = desc.height;
+        }
+
+        const nvrhi::TextureSlice pageSlice = { .width = page.width, .height = page.height };
+
+        size_t rowPitch = 0;
+        uint8_t* mapped = (uint8_t*)device->mapStagingTexture(page.texture, pageSlice, nvrhi::CpuAccessMode::Write, &rowPitch);
+        CORE_ASSERT(mapped);
+
+        for (const TextureUpload* upload = begin; upload != end; ++upload)
+        {
+            uint8_t* dst = mapped + upload->stagingY * rowPitch + upload->stagingX * bytesPerPixel;
+            for (uint32_t row = 0; row < upload->h; ++row)
+                std::memcpy(dst + row * rowPitch, upload->pixels + row * upload->pitch, upload->w * bytesPerPixel);
+
+            stats.textureUploadBytes += upload->w * upload->h * bytesPerPixel;
+            (upload->atlasGrow ? stats.textureGrowUploadTexels : stats.textureUploadTexels) += upload->w * upload->h;
+        }
+
+        device->unmapStagingTexture(page.texture);
+
+        nvrhi::ICommandList* commandList = GetTextureCommandList();
+        for (const TextureUpload* upload = begin; upload != end; ++upload)
+        {
+            nvrhi::TextureSlice dstSlice = { .x = upload->x, .y = upload->y, .width = upload->w, .height = upload->h };
+            nvrhi::TextureSlice srcSlice = { .x = upload->stagingX, .y = upload->stagingY, .width = upload->w, .height = upload->h };
+            commandList->copyTexture(upload->texture, dstSlice, page.texture, srcSlice);
+        }
+    }
+
+    // The texture a growing atlas is replacing: ImGui flags it for destruction on the next frame when it adds the new one
+    static ImTextureData* FindReplacedAtlas(const ImTextureData* tex)
+    {
+        for (ImTextureData* old : ImGui::GetPlatformIO().Textures)
+        {
+            if (old == tex || !old->WantDestroyNextFrame || !old->Pixels || old->TexID == ImTextureID_Invalid)
+                continue;
+
+            if (old->Format == tex->Format && old->Width <= tex->Width && old->Height <= tex->Height)
+                return old;
+        }
+
+        return nullptr;
+    }
+
+    static bool RegionsMatch(const ImTextureData* a, const ImTextureData* b, int x, int y, int w, int h)
+    {
+        const size_t rowBytes = size_t(w) * a->BytesPerPixel;
+        for (int row = 0; row < h; row++)
+            if (std::memcmp(a->GetPixelsAt(x, y + row), b->GetPixelsAt(x, y + row), rowBytes) != 0)
+                return false;
+
+        return true;
+    }
+
+    static bool RegionIsZero(const ImTextureData* tex, int x, int y, int w, int h)
+    {
+        const size_t rowBytes = size_t(w) * tex->BytesPerPixel;
+        for (int row = 0; row < h; row++)
+        {
+            const uint8_t* pixels = (const uint8_t*)tex->GetPixelsAt(x, y + row);
+            for (size_t i = 0; i < rowBytes; i++)
+                if (pixels[i])
+                    return false;
+        }
+
+        return true;
+    }
+
+    // Fills a grown atlas from the texture it replaces. ImGui repacks the atlas on grow: when only the height grew the
+    // packer puts every rect back in place, when the width grew most of them move. So the new atlas is compared with
+    // the old one tile by tile: tiles that still match are copied on the GPU, empty tiles are covered by a clear and
+    // only the rest is uploaded, one rect per run of tiles in a tile row.
+    void CreateFromReplacedAtlas(ImTextureData* tex, nvrhi::ITexture* texture, const ImTextureData* old)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        nvrhi::ITexture* oldTexture = (nvrhi::ITexture*)old->TexID;
+        GetTextureCommandList()->clearTextureFloat(texture, nvrhi::AllSubresources, nvrhi::Color(0.f));
+
+        enum class TileSource : uint8_t { Clear, Copy, Upload };
+
+        const auto flushRun = [&](TileSource source, int x0, int x1, int y, int h) {
+
+            if (x1 <= x0 || source == TileSource::Clear)
+                return;
+
+            if (source == TileSource::Copy)
+            {
+                textureCopies.push_back({ texture, oldTexture, uint32_t(x0), uint32_t(y), uint32_t(x1 - x0), uint32_t(h) });
+                return;
+            }
+
+            TextureUpload& upload = textureUploads.emplace_back();
+            upload.texture = texture;
+            upload.pixels = (const uint8_t*)tex->GetPixelsAt(x0, y);
+            upload.pitch = uint32_t(tex->GetPitch());
+            upload.bytesPerPixel = uint32_t(tex->BytesPerPixel);
+            upload.x = x0;
+            upload.y = y;
+            upload.w = x1 - x0;
+            upload.h = h;
+            upload.atlasGrow = true;
+        };
+
+        const int tile = int(c_AtlasGrowTileSize);
+        for (int y = 0; y < tex->Height; y += tile)
+        {
+            const int h = std::min(tile, tex->Height - y);
+
+            TileSource runSource = TileSource::Clear;
+            int runStart = 0;
+
+            for (int x = 0; x < tex->Width; x += tile)
+            {
+                const int w = std::min(tile, tex->Width - x);
+                const bool insideOld = x + w <= old->Width && y + h <= old->Height;
+
+                TileSource source = TileSource::Upload;
+                if (RegionIsZero(tex, x, y, w, h))
+                    source = TileSource::Clear;
+                else if (insideOld && RegionsMatch(tex, old, x, y, w, h))
+                    source = TileSource::Copy;
+
+                if (source != runSource)
+                {
+                    flushRun(runSource, runStart, x, y, h);
+                    runSource = source;
+                    runStart = x;
+                }
+            }
+
+            flushRun(runSource, runStart, tex->Width, y, h);
+        }
+    }
+
+    void UpdateTexture(ImTextureData* tex)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        if (tex->Status == ImTextureStatus_WantCreate)
+        {
+            CORE_ASSERT(tex->TexID == 0 && tex->BackendUserData == nullptr);
+            CORE_ASSERT(tex->Format == ImTextureFormat_RGBA32 || tex->Format == ImTextureFormat_Alpha8);
+
+            const void* pixels = tex->GetPixels();
+
+            nvrhi::TextureDesc textureDesc;
+            textureDesc.width = tex->Width;
+            textureDesc.height = tex->Height;
+            textureDesc.format = tex->Format == ImTextureFormat_Alpha8 ? nvrhi::Format::R8_UNORM : nvrhi::Format::RGBA8_UNORM;
+            textureDesc.isUAV = true;
+            textureDesc.initialState = nvrhi::ResourceStates::ShaderResource;
+            textureDesc.keepInitialState = true;
+            textureDesc.debugName = "ImGui font texture";
+
+            nvrhi::ITexture* texture = device->createTexture(textureDesc).Detach();
+            CORE_ASSERT(texture);
+
+            if (const ImTextureData* old = FindReplacedAtlas(tex))
+            {
+                CreateFromReplacedAtlas(tex, texture, old);
+            }
+            else
+            {
+                // whole textures go through nvrhi's own upload memory, which keeps the staging pages small
+                GetTextureCommandList()->writeTexture(texture, 0, 0, pixels, tex->GetPitch());
+                stats.textureUploadBytes += size_t(tex->GetSizeInBytes());
+            }
+
+            tex->SetTexID(texture);
+            tex->Status = ImTextureStatus_OK;
+
+            //LOG_INFO("[ImGui] : ImTextureStatus_WantCreate : ({}, {}, {}), {}", tex->UniqueID, tex->Width, tex->Height, (uint64_t)(nvrhi::ITexture*)tex->GetTexID());
+        }
+
+        if (tex->Status == ImTextureStatus_WantUpdates)
+        {
+            //LOG_TRACE("[ImGui] : ImTextureStatus_WantUpdates : ({}, {}, {}), {}", tex->UniqueID, tex->Width, tex->Height, (uint64_t)(nvrhi::ITexture*)tex->GetTexID());
+            nvrhi::ITexture* texture = (nvrhi::ITexture*)tex->TexID;
+            CORE_ASSERT(texture);
+
+            // the individual rects, not UpdateRect: glyphs baked in opposite corners would upload most of the atlas
+            updateRects.clear();
+            for (const ImTextureRect& rect : tex->Updates)
+                if (rect.w && rect.h)
+                    updateRects.push_back(rect);
+
+            if (updateRects.empty() && tex->UpdateRect.w && tex->UpdateRect.h)
+                updateRects.push_back(tex->UpdateRect);
+
+            CoalesceRects(updateRects);
+
+            for (const ImTextureRect& rect : updateRects)
+            {
+                TextureUpload& upload = textureUploads.emplace_back();
+                upload.texture = texture;
+                upload.pixels = (const uint8_t*)tex->GetPixelsAt(rect.x, rect.y);
+                upload.pitch = uint32_t(tex->GetPitch());
+                upload.bytesPerPixel = uint32_t(tex->BytesPerPixel);
+                upload.x = rect.x;
+                upload.y = rect.y;
+                upload.w = rect.w;
+                upload.h = rect.h;
+            }
+
+            // the CPU copy stays valid until the next ImGui::NewFrame, after this frame is recorded
+            tex->Status = ImTextureStatus_OK;
+        }
+
+        if (tex->Status == ImTextureStatus_WantDestroy)
+        {
+            //LOG_ERROR("[ImGui] : ImTextureStatus_WantDestroy : ({}, {}, {}), {}", tex->UniqueID, tex->Width, tex->Height, (uint64_t)(nvrhi::ITexture*)tex->GetTexID());
+
+            // ImGui stopped using it, but the frames in flight may still sample it
+            nvrhi::TextureHandle texture;
+            texture.Attach((nvrhi::ITexture*)tex->GetTexID());
+            DeferRelease(texture);
+
+            tex->SetTexID(ImTextureID_Invalid);
+            tex->Status = ImTextureStatus_Destroyed;
+        }
+    }
+
+    nvrhi::IGraphicsPipeline* FindPSO(const nvrhi::FramebufferInfo& framebufferInfo, PipelineVariant variant, bool premultiplied = false) const
+    {
+        for (const CachedPipeline& cached : pipelines)
+            if (cached.variant == variant && cached.premultiplied == premultiplied && cached.framebufferInfo == framebufferInfo)
+                return cached.pipeline;
+
+        return nullptr;
+    }
+
+    nvrhi::IGraphicsPipeline* CreatePSO(const nvrhi::FramebufferInfo& framebufferInfo, PipelineVariant variant, bool premultiplied = false)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        nvrhi::GraphicsPipelineDesc desc =
+            variant == PipelineVariant::LayerClear ? layerClearPSODesc :
+            variant == PipelineVariant::Composite ? compositePSODesc :
+            variant == PipelineVariant::Bindless ? bindlessPSODesc :
+            variant == PipelineVariant::Alpha8 ? alpha8PSODesc :
+            basePSODesc;
+
+        // over transparent black, the color blend already leaves premultiplied color, the alpha has to accumulate coverage
+        if (premultiplied)
+        {
+            desc.renderState.blendState.targets[0]
+                .setSrcBlendAlpha(nvrhi::BlendFactor::One)
+                .setDestBlendAlpha(nvrhi::BlendFactor::InvSrcAlpha);
+        }
+
+        CachedPipeline& cached = pipelines.emplace_back();
+        cached.framebufferInfo = framebufferInfo;
+        cached.variant = variant;
+        cached.premultiplied = premultiplied;
+        cached.pipeline = device->createGraphicsPipeline(desc, framebufferInfo);
+        CORE_ASSERT(cached.pipeline);
+
+        return cached.pipeline;
+    }
+
+    nvrhi::IGraphicsPipeline* GetPSO(const nvrhi::FramebufferInfo& framebufferInfo, PipelineVariant variant, bool premultiplied = false)
+    {
+        if (nvrhi::IGraphicsPipeline* pipeline = FindPSO(framebufferInfo, variant, premultiplied))
+            return pipeline;
+
+        // a framebuffer layout nobody declared, compiled on the render path
+        totals.pipelineCacheMisses++;
+        return CreatePSO(framebufferInfo, variant, premultiplied);
+    }
+
+    void PrewarmPipelines(const nvrhi::FramebufferInfo& framebufferInfo, bool premultiplied = false)
+    {
+        if (!FindPSO(framebufferInfo, PipelineVariant::Default, premultiplied))
+            CreatePSO(framebufferInfo, PipelineVariant::Default, premultiplied);
+
+        if (!FindPSO(framebufferInfo, PipelineVariant::Alpha8, premultiplied))
+            CreatePSO(framebufferInfo, PipelineVariant::Alpha8, premultiplied);
+
+        if (descriptorTable && !FindPSO(framebufferInfo, PipelineVariant::Bindless, premultiplied))
+            CreatePSO(framebufferInfo, PipelineVariant::Bindless, premultiplied);
+
+        // window layers, and the UI cache for the main framebuffer, composite with the same pipeline into any target
+        if (!FindPSO(framebufferInfo, PipelineVariant::Composite))
+            CreatePSO(framebufferInfo, PipelineVariant::Composite);
+    }
+
+    // Framebuffer layouts added to the settings are compiled at the start of the next frame, before any recording
+    void PrewarmConfiguredPipelines()
+    {
+        for (; prewarmedFramebuffers < settings.prewarmFramebuffers.size(); prewarmedFramebuffers++)
+            PrewarmPipelines(settings.prewarmFramebuffers[prewarmedFramebuffers]);
+    }
+
+    bool UseBindless() const
+    {
+        return settings.bindlessTextures && descriptorTable && bindlessBindingSet && !descriptorTableFull;
+    }
+
+    void DeferRelease(nvrhi::IResource* resource)
+    {
+        if (resource)
+            deferredReleases.push_back({ resource, frameIndex });
+    }
+
+    // One hash lookup per call, hit or miss
+    TextureBinding& GetTextureBinding(nvrhi::ITexture* texture)
+    {
+        auto [it, inserted] = textureBindingLookup.try_emplace(texture, uint32_t(textureBindings.size()));
+        if (inserted)
+        {
+            TextureBinding& binding = textureBindings.emplace_back();
+            binding.texture = texture;
+            stats.bindingCacheMisses++;
+        }
+        else
+        {
+            stats.bindingCacheHits++;
+        }
+
+        TextureBinding& binding = textureBindings[it->second];
+        binding.lastUsedFrame = frameIndex;
+
+        return binding;
+    }
+
+    // Visits at most 'bindingCacheScanPerFrame' entries, picking up where the previous frame stopped. An entry goes
+    // when nothing but the cache references its texture anymore, or when it hasn't been drawn for a while.
+    void EvictTextureBindings()
+    {
+        const uint32_t budget = std::min(settings.bindingCacheScanPerFrame, uint32_t(textureBindings.size()));
+        for (uint32_t visited = 0; visited < budget && !textureBindings.empty(); visited++)
+        {
+            if (evictionCursor >= textureBindings.size())
+                evictionCursor = 0;
+
+            TextureBinding& binding = textureBindings[evictionCursor];
+
+            // the cache handle and the binding set are the only references left
+            const uint32_t ownRefs = 1 + (binding.bindingSet ? 1 : 0);
+            const bool orphaned = binding.texture->GetRefCount() <= ownRefs;
+            const bool stale = binding.lastUsedFrame + settings.bindingCacheStaleFrames < frameIndex;
+
+            if (!orphaned && !stale)
+            {
+                evictionCursor++;
+                continue;
+            }
+
+            if (binding.bindlessIndex != c_InvalidBindlessIndex)
+                retiredBindlessSlots.push_back({ binding.bindlessIndex, frameIndex });
+
+            DeferRelease(binding.bindingSet);
+            DeferRelease(binding.texture);
+            textureBindingLookup.erase(binding.texture.Get());
+
+            // swap with the last entry, the cursor stays to visit the moved one
+            if (evictionCursor != textureBindings.size() - 1)
+            {
+                binding = std::move(textureBindings.back());
+                textureBindingLookup[binding.texture.Get()] = evictionCursor;
+            }
+            textureBindings.pop_back();
+
+            stats.bindingCacheEvictions++;
+        }
+
+        stats.bindingCacheSize = uint32_t(textureBindings.size());
+    }
+
+    // Index of the texture in the descriptor table, written into the table the first time the texture is drawn
+    uint32_t GetBindlessIndex(nvrhi::ITexture* texture)
+    {
+        TextureBinding& binding = GetTextureBinding(texture);
+        if (binding.bindlessIndex != c_InvalidBindlessIndex)
+            return binding.bindlessIndex;
+
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        // slots of evicted textures are reused once the frames that may have sampled them are done
+        uint32_t index = nextBindlessIndex;
+        auto retired = std::find_if(retiredBindlessSlots.begin(), retiredBindlessSlots.end(), [this](const RetiredBindlessSlot& r) {
+            return r.frame <= completedFrame;
+        });
+
+        if (retired != retiredBindlessSlots.end())
+        {
+            index = retired->index;
+            retiredBindlessSlots.erase(retired);
+        }
+        else
+        {
+            nextBindlessIndex++;
+        }
+
+        // the viewport being prepared already draws through the table, that texture shows slot 0 for one frame
+        if (index >= bindlessCapacity)
+        {
+            nextBindlessIndex = bindlessCapacity;
+            if (!descriptorTableFull)
+                LOG_ERROR("[HEImGui] bindless descriptor table full ({} textures), falling back to binding sets", bindlessCapacity);
+
+            descriptorTableFull = true;
+            return 0;
+        }
+
+        device->writeDescriptorTable(descriptorTable, nvrhi::BindingSetItem::Texture_SRV(index, texture));
+        binding.bindlessIndex = index;
+
+        return index;
+    }
+
+    nvrhi::IBindingSet* GetBindingSet(nvrhi::ITexture* texture)
+    {
+        TextureBinding& binding = GetTextureBinding(texture);
+        if (binding.bindingSet)
+            return binding.bindingSet;
+
+        nvrhi::BindingSetDesc desc;
+
+        desc.bindings = {
+            nvrhi::BindingSetItem::PushConstants(0, sizeof(PushConstants)),
+            nvrhi::BindingSetItem::Texture_SRV(0, texture),
+            nvrhi::BindingSetItem::Sampler(0, fontSampler)
+        };
+
+        binding.bindingSet = device->createBindingSet(desc, bindingLayout);
+        CORE_ASSERT(binding.bindingSet);
+
+        return binding.bindingSet;
+    }
+
+    // Uploads the geometry of 'count' viewports back to back, 'ranges[i]' receives where viewport i ended up
+    bool UpdateGeometry(RenderContext& ctx, ImDrawData* const* drawData, uint32_t count, GeometryRange* ranges)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        // D3D11 has no persistent mapping, and its immediate command list gets nothing out of the ring
+        if (settings.geometryUpload == HEImGui::GeometryUpload::MappedRing && device->getGraphicsAPI() != nvrhi::GraphicsAPI::D3D11)
+        {
+            for (uint32_t i = 0; i < count; i++)
+                if (!UpdateGeometryMapped(ctx, drawData[i], ranges[i]))
+                    return false;
+
+            return true;
+        }
+
+        if (settings.incrementalGeometryUpload)
+            return UpdateGeometryResident(ctx, drawData, count, ranges);
+
+        GeometryBuffer& vertexBuffer = ctx.vertexBuffer;
+        GeometryBuffer& indexBuffer = ctx.indexBuffer;
+        std::vector<ImDrawVert>& vtxBuffer = ctx.vtxBuffer;
+        std::vector<ImDrawIdx>& idxBuffer = ctx.idxBuffer;
+
+        int totalVtxCount = 0;
+        int totalIdxCount = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            totalVtxCount += drawData[i]->TotalVtxCount;
+            totalIdxCount += drawData[i]->TotalIdxCount;
+        }
+
+        const size_t vtxBytes = totalVtxCount * sizeof(ImDrawVert);
+        const size_t idxBytes = totalIdxCount * sizeof(ImDrawIdx);
+
+        // create/resize vertex and index buffers if needed
+        if (!ReallocateBuffer(vertexBuffer, vtxBytes))
+            return false;
+
+        if (!ReallocateBuffer(indexBuffer, idxBytes))
+            return false;
+
+        // the CPU copies only hold what this frame uploads
+        vtxBuffer.resize(std::max(totalVtxCount, 1));
+        idxBuffer.resize(std::max(totalIdxCount, 1));
+
+        // copy and convert all vertices into a single contiguous buffer
+        ImDrawVert* vtxDst = &vtxBuffer[0];
+        ImDrawIdx* idxDst = &idxBuffer[0];
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            GeometryRange& range = ranges[i];
+            range.vertexBuffer = vertexBuffer.buffer;
+            range.indexBuffer = indexBuffer.buffer;
+            range.vertexOffset = (vtxDst - &vtxBuffer[0]) * sizeof(ImDrawVert);
+            range.indexOffset = (idxDst - &idxBuffer[0]) * sizeof(ImDrawIdx);
+
+            for (int n = 0; n < drawData[i]->CmdListsCount; n++)
+            {
+                const ImDrawList* cmdList = drawData[i]->CmdLists[n];
+
+                memcpy(vtxDst, cmdList->VtxBuffer.Data, cmdList->VtxBuffer.Size * sizeof(ImDrawVert));
+                memcpy(idxDst, cmdList->IdxBuffer.Data, cmdList->IdxBuffer.Size * sizeof(ImDrawIdx));
+
+                vtxDst += cmdList->VtxBuffer.Size;
+                idxDst += cmdList->IdxBuffer.Size;
+            }
+        }
+
+        // only the part in use, not the whole capacity
+        nvrhi::ICommandList* commandList = ctx.commandList;
+        if (vtxBytes) commandList->writeBuffer(vertexBuffer.buffer, &vtxBuffer[0], vtxBytes);
+        if (idxBytes) commandList->writeBuffer(indexBuffer.buffer, &idxBuffer[0], idxBytes);
+        stats.uploadBytes += vtxBytes + idxBytes;
+
+        // the resident layout no longer matches the buffers, turning incrementalGeometryUpload back on starts over
+        ctx.residentVertexBuffer = nullptr;
+        ctx.residentIndexBuffer = nullptr;
+        ctx.residentLists.clear();
+
+        return true;
+    }
+
+    static uint32_t ResidentCapacity(int count)
+    {
+        return (uint32_t(count) + c_ResidentListGranularity - 1) / c_ResidentListGranularity * c_ResidentListGranularity;
+    }
+
+    // Settings::incrementalGeometryUpload: every draw list keeps its place in the device-local buffers across frames
+    // and only lists whose geometry hash changed are written again. The queue runs in order, so a write recorded
+    // now lands after the draws of the frames in flight that read the old content. Everything is laid out again
+    // when the buffers were replaced, a list doesn't fit anywhere, or too much of the used range is free.
+    bool UpdateGeometryResident(RenderContext& ctx, ImDrawData* const* drawData, uint32_t count, GeometryRange* ranges)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        GeometryBuffer& vertexBuffer = ctx.vertexBuffer;
+        GeometryBuffer& indexBuffer = ctx.indexBuffer;
+
+        bool relayout = !vertexBuffer.buffer || !indexBuffer.buffer ||
+            vertexBuffer.buffer != ctx.residentVertexBuffer || indexBuffer.buffer != ctx.residentIndexBuffer ||
+            std::max(ctx.vertexRegions.Fragmentation(), ctx.indexRegions.Fragmentation()) > settings.geometryCompactionThreshold;
+
+        const uint32_t vertexCapacity = uint32_t(vertexBuffer.Capacity() / sizeof(ImDrawVert));
+        const uint32_t indexCapacity = uint32_t(indexBuffer.Capacity() / sizeof(ImDrawIdx));
+
+        // hash every list and mark it seen, the lists that are gone give their regions back
+        size_t listCount = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            for (int n = 0; n < drawData[i]->CmdListsCount; n++)
+            {
+                const ImDrawList* cmdList = drawData[i]->CmdLists[n];
+
+                uint64_t hash = c_HashSeed;
+                HashBytes(hash, cmdList->VtxBuffer.Data, cmdList->VtxBuffer.size_in_bytes());
+                HashBytes(hash, cmdList->IdxBuffer.Data, cmdList->IdxBuffer.size_in_bytes());
+
+                ResidentList& list = ctx.residentLists[cmdList];
+                list.dirty = list.vertexCapacity == 0 || list.hash != hash ||
+                    list.vertexCount != uint32_t(cmdList->VtxBuffer.Size) || list.indexCount != uint32_t(cmdList->IdxBuffer.Size);
+                list.hash = hash;
+                list.lastFrame = frameIndex;
+                listCount++;
+            }
+        }
+
+        for (auto it = ctx.residentLists.begin(); it != ctx.residentLists.end();)
+        {
+            if (it->second.lastFrame == frameIndex)
+            {
+                ++it;
+                continue;
+            }
+
+            if (!relayout && it->second.vertexCapacity)
+            {
+                ctx.vertexRegions.Free(it->second.vertexStart, it->second.vertexCapacity);
+                ctx.indexRegions.Free(it->second.indexStart, it->second.indexCapacity);
+            }
+            it = ctx.residentLists.erase(it);
+        }
+
+        // changed lists stay where they are if they still fit, the others move to a free range
+        for (uint32_t i = 0; i < count && !relayout; i++)
+        {
+            for (int n = 0; n < drawData[i]->CmdListsCount && !relayout; n++)
+            {
+                const ImDrawList* cmdList = drawData[i]->CmdLists[n];
+                ResidentList& list = ctx.residentLists[cmdList];
+
+                list.vertexCount = uint32_t(cmdList->VtxBuffer.Size);
+                list.indexCount = uint32_t(cmdList->IdxBuffer.Size);
+
+                if (!list.dirty || (list.vertexCount <= list.vertexCapacity && list.indexCount <= list.indexCapacity && list.vertexCapacity))
+                    continue;
+
+                if (list.vertexCapacity)
+                {
+                    ctx.vertexRegions.Free(list.vertexStart, list.vertexCapacity);
+                    ctx.indexRegions.Free(list.indexStart, list.indexCapacity);
+                }
+
+                list.vertexCapacity = ResidentCapacity(cmdList->VtxBuffer.Size);
+                list.indexCapacity = ResidentCapacity(cmdList->IdxBuffer.Size);
+
+                relayout = !ctx.vertexRegions.Allocate(list.vertexCapacity, vertexCapacity, list.vertexStart) ||
+                    !ctx.indexRegions.Allocate(list.indexCapacity, indexCapacity, list.indexStart);
+            }
+        }
+
+        if (relayout)
+        {
+            CORE_PROFILE_SCOPE_NC("Relayout Geometry", HE_PROFILE_IMGUI);
+
+            uint32_t totalVertices = 0;
+            uint32_t totalIndices = 0;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                for (int n = 0; n < drawData[i]->CmdListsCount; n++)
+                {
+                    totalVertices += ResidentCapacity(drawData[i]->CmdLists[n]->VtxBuffer.Size);
+                    totalIndices += ResidentCapacity(drawData[i]->CmdLists[n]->IdxBuffer.Size);
+                }
+            }
+
+            if (!ReallocateBuffer(vertexBuffer, size_t(totalVertices) * sizeof(ImDrawVert)))
+                return false;
+
+            if (!ReallocateBuffer(indexBuffer, size_t(totalIndices) * sizeof(ImDrawIdx)))
+                return false;
+
+            ctx.residentVertexBuffer = vertexBuffer.buffer;
+            ctx.residentIndexBuffer = indexBuffer.buffer;
+            ctx.vertexRegions.Reset();
+            ctx.indexRegions.Reset();
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                for (int n = 0; n < drawData[i]->CmdListsCount; n++)
+                {
+                    const ImDrawList* cmdList = drawData[i]->CmdLists[n];
+                    ResidentList& list = ctx.residentLists[cmdList];
+
+                    list.vertexCount = uint32_t(cmdList->VtxBuffer.Size);
+                    list.indexCount = uint32_t(cmdList->IdxBuffer.Size);
+                    list.vertexCapacity = ResidentCapacity(cmdList->VtxBuffer.Size);
+                    list.indexCapacity = ResidentCapacity(cmdList->IdxBuffer.Size);
+                    list.dirty = true;
+
+                    ctx.vertexRegions.Allocate(list.vertexCapacity, totalVertices, list.vertexStart);
+                    ctx.indexRegions.Allocate(list.indexCapacity, totalIndices, list.indexStart);
+                }
+            }
+
+            totals.geometryCompactions++;
+        }
+        else
+        {
+            // keeps the shrink policy informed, the buffers are only written in part
+            vertexBuffer.peakBytes = std::max(vertexBuffer.peakBytes, size_t(ctx.vertexRegions.top) * sizeof(ImDrawVert));
+            indexBuffer.peakBytes = std::max(indexBuffer.peakBytes, size_t(ctx.indexRegions.top) * sizeof(ImDrawIdx));
+        }
+
+        // write the dirty lists straight from the draw lists, and place every list for BuildBatches
+        nvrhi::ICommandList* commandList = ctx.commandList;
+        ctx.listPlacements.clear();
+        ctx.listPlacements.reserve(listCount);
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            for (int n = 0; n < drawData[i]->CmdListsCount; n++)
+            {
+                const ImDrawList* cmdList = drawData[i]->CmdLists[n];
+                ResidentList& list = ctx.residentLists[cmdList];
+
+                const size_t vtxBytes = cmdList->VtxBuffer.size_in_bytes();
+                const size_t idxBytes = cmdList->IdxBuffer.size_in_bytes();
+
+                if (list.dirty)
+                {
+                    if (vtxBytes) commandList->writeBuffer(vertexBuffer.buffer, cmdList->VtxBuffer.Data, vtxBytes, uint64_t(list.vertexStart) * sizeof(ImDrawVert));
+                    if (idxBytes) commandList->writeBuffer(indexBuffer.buffer, cmdList->IdxBuffer.Data, idxBytes, uint64_t(list.indexStart) * sizeof(ImDrawIdx));
+                    stats.uploadBytes += vtxBytes + idxBytes;
+                    list.dirty = false;
+                }
+                else
+                {
+                    stats.uploadSkippedBytes += vtxBytes + idxBytes;
+                }
+
+                ctx.listPlacements.push_back({ list.vertexStart, list.indexStart });
+            }
+        }
+
+        const ListPlacement* placements = ctx.listPlacements.data();
+        for (uint32_t i = 0; i < count; i++)
+        {
+            GeometryRange& range = ranges[i];
+            range.vertexBuffer = vertexBuffer.buffer;
+            range.indexBuffer = indexBuffer.buffer;
+            range.vertexOffset = 0;
+            range.indexOffset = 0;
+            range.lists = placements;
+            placements += drawData[i]->CmdListsCount;
+        }
+
+        return true;
+    }
+
+    // Keeps the ring buffer large enough for 'requiredSize' more bytes past 'offset'. A buffer that has to grow
+    // mid-frame is replaced and the new one starts at offset 0, submitted command lists keep the old one alive.
+    bool ReserveRing(GeometryBuffer& gb, size_t& offset, size_t requiredSize)
+    {
+        // size for the whole frame so far, so the next viewport doesn't have to grow it again
+        const size_t frameSize = offset + requiredSize;
+        if (gb.buffer && frameSize <= gb.Capacity())
+        {
+            gb.peakBytes = std::max(gb.peakBytes, frameSize);
+            return true;
+        }
+
+        if (!ReallocateBuffer(gb, frameSize))
+            return false;
+
+        offset = 0;
+        return true;
+    }
+
+    // Copies the draw lists straight into the persistently mapped buffers of the current frame slot
+    bool UpdateGeometryMapped(RenderContext& ctx, ImDrawData* drawData, GeometryRange& range)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        UploadRing& ring = ctx.rings[frameIndex % c_FramesInFlight];
+
+        // keep suballocations aligned for the vertex/index buffer views of every API
+        constexpr size_t alignment = 256;
+        ring.vtxOffset = (ring.vtxOffset + alignment - 1) & ~(alignment - 1);
+        ring.idxOffset = (ring.idxOffset + alignment - 1) & ~(alignment - 1);
+
+        const size_t vtxBytes = drawData->TotalVtxCount * sizeof(ImDrawVert);
+        const size_t idxBytes = drawData->TotalIdxCount * sizeof(ImDrawIdx);
+
+        if (!ReserveRing(ring.vertexBuffer, ring.vtxOffset, vtxBytes))
+            return false;
+
+        if (!ReserveRing(ring.indexBuffer, ring.idxOffset, idxBytes))
+            return false;
+
+        uint8_t* vtxDst = ring.vertexBuffer.mapped + ring.vtxOffset;
+        uint8_t* idxDst = ring.indexBuffer.mapped + ring.idxOffset;
+
+        for (int n = 0; n < drawData->CmdListsCount; n++)
+        {
+            const ImDrawList* cmdList = drawData->CmdLists[n];
+
+            const size_t listVtxBytes = cmdList->VtxBuffer.Size * sizeof(ImDrawVert);
+            const size_t listIdxBytes = cmdList->IdxBuffer.Size * sizeof(ImDrawIdx);
+
+            memcpy(vtxDst, cmdList->VtxBuffer.Data, listVtxBytes);
+            memcpy(idxDst, cmdList->IdxBuffer.Data, listIdxBytes);
+
+            vtxDst += listVtxBytes;
+            idxDst += listIdxBytes;
+        }
+
+        range.vertexBuffer = ring.vertexBuffer.buffer;
+        range.indexBuffer = ring.indexBuffer.buffer;
+        range.vertexOffset = ring.vtxOffset;
+        range.indexOffset = ring.idxOffset;
+
+        ring.vtxOffset += vtxBytes;
+        ring.idxOffset += idxBytes;
+        stats.uploadBytes += vtxBytes + idxBytes;
+
+        return true;
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+// Font Cache
+//////////////////////////////////////////////////////////////////////////
+
+// stb_compress decoder, the format of the *_compressed_data arrays under Embeded/fonts (same as ImGui's, which is private)
+struct StbDecompressor
+{
+    uint8_t* out = nullptr;
+    uint8_t* outBegin = nullptr;
+    uint8_t* outEnd = nullptr;
+    const uint8_t* inBegin = nullptr;
+
+    static uint32_t In2(const uint8_t* i) { return (i[0] << 8) + i[1]; }
+    static uint32_t In3(const uint8_t* i) { return (i[0] << 16) + In2(i + 1); }
+    static uint32_t In4(const uint8_t* i) { return (uint32_t(i[0]) << 24) + In3(i + 1); }
+
+    static uint32_t DecompressedSize(const uint8_t* input) { return In4(input + 8); }
+
+    // The stream ends with the adler32 of the decompressed data
+    static uint32_t Checksum(const uint8_t* input, size_t inputSize) { return inputSize >= 4 ? In4(input + inputSize - 4) : 0; }
+
+    void Match(const uint8_t* data, uint32_t length)
+    {
+        if (out + length > outEnd || data < outBegin) { out = outEnd + 1; return; }
+        while (length--) *out++ = *data++; // overlapping copies repeat the pattern, no memmove
+    }
+
+    void Literal(const uint8_t* data, uint32_t length)
+    {
+        if (out + length > outEnd || data < inBegin) { out = outEnd + 1; return; }
+        std::memcpy(out, data, length);
+        out += length;
+    }
+
+    const uint8_t* Token(const uint8_t* i)
+    {
+        if (*i >= 0x20)
+        {
+            if (*i >= 0x80)      { Match(out - i[1] - 1, i[0] - 0x80 + 1); i += 2; }
+            else if (*i >= 0x40) { Match(out - (In2(i) - 0x4000 + 1), i[2] + 1); i += 3; }
+            else                 { const uint32_t n = i[0] - 0x20 + 1; Literal(i + 1, n); i += 1 + n; }
+        }
+        else
+        {
+            if (*i >= 0x18)      { Match(out - (In3(i) - 0x180000 + 1), i[3] + 1); i += 4; }
+            else if (*i >= 0x10) { Match(out - (In3(i) - 0x100000 + 1), In2(i + 3) + 1); i += 5; }
+            else if (*i >= 0x08) { const uint32_t n = In2(i) - 0x0800 + 1; Literal(i + 2, n); i += 2 + n; }
+            else if (*i == 0x07) { const uint32_t n = In2(i + 1) + 1; Literal(i + 3, n); i += 3 + n; }
+            else if (*i == 0x06) { Match(out - (In3(i + 1) + 1), i[4] + 1); i += 5; }
+            else if (*i == 0x04) { Match(out - (In3(i + 1) + 1), In2(i + 4) + 1); i += 6; }
+        }
+
+        return i;
+    }
+
+    static uint32_t Adler32(const uint8_t* buffer, uint32_t length)
+    {
+        constexpr uint32_t mod = 65521;
+        uint32_t s1 = 1, s2 = 0;
+
+        while (length)
+        {
+            const uint32_t block = std::min(length, 5552u);
+            for (uint32_t i = 0; i < block; i++)
+            {
+                s1 += buffer[i];
+                s2 += s1;
             }
 
-            idxOffset += cmdList->IdxBuffer.Size;
-            vtxOffset += cmdList->VtxBuffer.Size;
+            s1 %= mod;
+            s2 %= mod;
+            buffer += block;
+            length -= block;
         }
 
-        BUILTIN_PROFILE_END();
-        commandList->endMarker();
-        commandList->close();
-        device->executeCommandList(commandList);
-
-        return true;
+        return (s2 << 16) + s1;
     }
 
-    bool ReallocateBuffer(nvrhi::BufferHandle& buffer, size_t requiredSize, size_t reallocateSize, bool isIndexBuffer)
+    // 'output' must hold DecompressedSize(input) bytes
+    bool Decompress(uint8_t* output, const uint8_t* input)
     {
-        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+        if (In4(input) != 0x57bC0000 || In4(input + 4) != 0)
+            return false;
 
-        if (buffer == nullptr || size_t(buffer->getDesc().byteSize) < requiredSize)
-        {
-            nvrhi::BufferDesc desc;
-            desc.byteSize = uint32_t(reallocateSize);
-            desc.structStride = 0;
-            desc.debugName = isIndexBuffer ? "ImGui index buffer" : "ImGui vertex buffer";
-            desc.canHaveUAVs = false;
-            desc.isVertexBuffer = !isIndexBuffer;
-            desc.isIndexBuffer = isIndexBuffer;
-            desc.isDrawIndirectArgs = false;
-            desc.isVolatile = false;
-            desc.initialState = isIndexBuffer ? nvrhi::ResourceStates::IndexBuffer : nvrhi::ResourceStates::VertexBuffer;
-            desc.keepInitialState = true;
+        const uint32_t size = DecompressedSize(input);
+        inBegin = input;
+        outBegin = output;
+        outEnd = output + size;
+        out = output;
 
-            buffer = device->createBuffer(desc);
+        const uint8_t* i = input + 16;
+        for (;;)
+        {
+            const uint8_t* token = i;
+            i = Token(i);
 
-            if (!buffer)
+            if (i == token)
             {
-                return false;
+                // end of stream
+                if (i[0] != 0x05 || i[1] != 0xfa || out != outEnd)
+                    return false;
+
+                return Adler32(output, size) == In4(i + 2);
             }
-        }
 
-        return true;
+            if (out > outEnd)
+                return false;
+        }
     }
+};
+
+// Read-only mapping of a whole file
+struct MappedFile
+{
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { Close(); }
 
-    void UpdateTextureRegion(
-        nvrhi::ICommandList* commandList,
-        nvrhi::ITexture* texture,
-        uint32_t x, uint32_t y, uint32_t w, uint32_t h,
-        uint8_t* bytes
-    )
+    bool Open(const std::filesystem::path& path)
     {
-        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+        Close();
 
-        size_t outRowPitch = 0;
-        nvrhi::TextureSlice desTc = { .x = x, .y = y, .width = w, .height = h };
-        nvrhi::TextureSlice srcTc = { .width = w, .height = h, };
+#ifdef _WIN32
+        file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
 
-        auto desc = texture->getDesc();
-        desc.debugName = "StagingTexture";
-        desc.width = w;
-        desc.height = h;
+        LARGE_INTEGER fileSize = {};
+        GetFileSizeEx(file, &fileSize);
+        size = size_t(fileSize.QuadPart);
 
-        nvrhi::StagingTextureHandle stagingTexture = device->createStagingTexture(desc, nvrhi::CpuAccessMode::Write);
+        mapping = size ? CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        data = mapping ? (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
 
-        uint8_t* mapped = (uint8_t*)device->mapStagingTexture(stagingTexture, srcTc, nvrhi::CpuAccessMode::Write, &outRowPitch);
+        struct stat st = {};
+        fstat(fd, &st);
+        size = size_t(st.st_size);
 
-        for (uint32_t row = 0; row < h; ++row)
-        {
-            std::memcpy(
-                mapped + row * outRowPitch,
-                bytes + (row * (texture->getDesc().width) * 4),
-                outRowPitch
-            );
-        }
-        device->unmapStagingTexture(stagingTexture);
+        void* view = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        data = view != MAP_FAILED ? (const uint8_t*)view : nullptr;
+#endif
 
-        commandList->copyTexture(texture, desTc, stagingTexture, srcTc);
+        if (!data)
+            Close();
+
+        return data != nullptr;
     }
 
-    void UpdateTexture(ImTextureData* tex)
+    void Close()
     {
-        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap((void*)data, size);
+        if (fd >= 0) close(fd);
+        fd = -1;
+#endif
+        data = nullptr;
+        size = 0;
+    }
+};
 
-        if (tex->Status == ImTextureStatus_WantCreate)
-        {
-            CORE_ASSERT(tex->TexID == 0 && tex->BackendUserData == nullptr);
-            CORE_ASSERT(tex->Format == ImTextureFormat_RGBA32);
+// Decompressed embedded fonts, written next to each other in a cache directory on the first launch and mapped on the
+// following ones, so warm starts skip the inflate and the heap copy. Files are named after a hash of the compressed
+// data, a changed font gets a new file. Dear ImGui 1.92 bakes glyphs on demand at whatever size is drawn, so there is
+// no atlas left to cache: the TTF bytes are what every launch and every DPI change used to pay for.
+// The directory is per user and private, a mapped file is only used once its size and the adler32 stored at the end
+// of the compressed stream match, anything else is decompressed again and replaced.
+struct FontCache
+{
+    struct Entry
+    {
+        MappedFile file;
+        std::vector<uint8_t> memory; // when the cache directory isn't writable
+    };
 
-            const void* pixels = tex->GetPixels();
+    std::filesystem::path directory; // empty: decompress to memory only
+    std::unordered_map<uint64_t, std::unique_ptr<Entry>> entries;
+    uint32_t hits = 0;   // fonts mapped from the cache
+    uint32_t misses = 0; // fonts decompressed
+    uint32_t tempCounter = 0;
 
-            nvrhi::TextureDesc textureDesc;
-            textureDesc.width = tex->Width;
-            textureDesc.height = tex->Height;
-            textureDesc.format = nvrhi::Format::RGBA8_UNORM;
-            textureDesc.isUAV = true;
-            textureDesc.initialState = nvrhi::ResourceStates::ShaderResource;
-            textureDesc.keepInitialState = true;
-            textureDesc.debugName = "ImGui font texture";
+    static uint64_t Hash(const uint8_t* data, size_t size)
+    {
+        uint64_t hash = 14695981039346656037ull; // FNV-1a
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ data[i]) * 1099511628211ull;
 
-            nvrhi::ITexture* texture = device->createTexture(textureDesc).Detach();
-            CORE_ASSERT(texture);
+        return hash;
+    }
 
-            auto cl = device->createCommandList();
-            cl->open();
-            cl->writeTexture(texture, 0, 0, pixels, tex->Width * 4);
-            cl->close();
-            device->executeCommandList(cl);
+#ifdef _WIN32
+    static std::filesystem::path UserCacheDirectory()
+    {
+        const wchar_t* localAppData = _wgetenv(L"LOCALAPPDATA");
+        if (!localAppData || !*localAppData)
+            return {};
 
-            tex->SetTexID(texture);
-            tex->Status = ImTextureStatus_OK;
+        return std::filesystem::path(localAppData) / "HEImGui" / "FontCache";
+    }
 
-            //LOG_INFO("[ImGui] : ImTextureStatus_WantCreate : ({}, {}, {}), {}", tex->UniqueID, tex->Width, tex->Height, (uint64_t)(nvrhi::ITexture*)tex->GetTexID());
-        }
+    static bool CreatePrivateDirectory(const std::filesystem::path& path)
+    {
+        // %LOCALAPPDATA% is only accessible to its user, subdirectories inherit that
+        std::error_code ec;
+        std::filesystem::create_directories(path, ec);
+        return std::filesystem::is_directory(path, ec);
+    }
+#else
+    static std::filesystem::path UserCacheDirectory()
+    {
+        if (const char* xdg = getenv("XDG_CACHE_HOME"); xdg && *xdg == '/')
+            return std::filesystem::path(xdg) / "HEImGui" / "FontCache";
 
-        if (tex->Status == ImTextureStatus_WantUpdates)
-        {
-            //LOG_TRACE("[ImGui] : ImTextureStatus_WantUpdates : ({}, {}, {}), {}", tex->UniqueID, tex->Width, tex->Height, (uint64_t)(nvrhi::ITexture*)tex->GetTexID());
-            nvrhi::ITexture* texture = (nvrhi::ITexture*)tex->TexID;
-            CORE_ASSERT(texture);
+        if (const char* home = getenv("HOME"); home && *home == '/')
+            return std::filesystem::path(home) / ".cache" / "HEImGui" / "FontCache";
 
-            auto cl = device->createCommandList();
-            cl->open();
+        // shared temp directory, the per user subdirectory is checked to be ours before it is used
+        std::error_code ec;
+        const std::filesystem::path temp = std::filesystem::temp_directory_path(ec);
+        if (ec)
+            return {};
 
-            const int upload_x = (tex->Status == ImTextureStatus_WantCreate) ? 0 : tex->UpdateRect.x;
-            const int upload_y = (tex->Status == ImTextureStatus_WantCreate) ? 0 : tex->UpdateRect.y;
-            const int upload_w = (tex->Status == ImTextureStatus_WantCreate) ? tex->Width : tex->UpdateRect.w;
-            const int upload_h = (tex->Status == ImTextureStatus_WantCreate) ? tex->Height : tex->UpdateRect.h;
-            UpdateTextureRegion(cl, texture, upload_x, upload_y, upload_w, upload_h, (uint8_t*)tex->GetPixelsAt(upload_x, upload_y));
+        return temp / std::format("HEImGui-{}", geteuid()) / "FontCache";
+    }
 
-            cl->close();
-            device->executeCommandList(cl);
-            tex->Status = ImTextureStatus_OK;
+    // Creates every missing component 0700, then makes sure the final one and its parent are
+    // real directories owned by us that no one else can write to
+    static bool CreatePrivateDirectory(const std::filesystem::path& path)
+    {
+        std::filesystem::path current;
+        for (const std::filesystem::path& part : path)
+        {
+            current /= part;
+            if (mkdir(current.c_str(), 0700) != 0 && errno != EEXIST)
+                return false;
         }
 
-        if (tex->Status == ImTextureStatus_WantDestroy)
+        auto isPrivate = [](const std::filesystem::path& dir)
         {
-            //LOG_ERROR("[ImGui] : ImTextureStatus_WantDestroy : ({}, {}, {}), {}", tex->UniqueID, tex->Width, tex->Height, (uint64_t)(nvrhi::ITexture*)tex->GetTexID());
+            struct stat st = {};
+            return lstat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode) && st.st_uid == geteuid() && (st.st_mode & 022) == 0;
+        };
 
-            nvrhi::TextureHandle texture;
-            texture.Attach((nvrhi::ITexture*)tex->GetTexID());
+        return isPrivate(path) && isPrivate(path.parent_path());
+    }
+#endif
 
-            tex->SetTexID(ImTextureID_Invalid);
-            tex->Status = ImTextureStatus_Destroyed;
+    // Per user cache directory, empty when none can be created safely
+    static std::filesystem::path PrivateDirectory()
+    {
+        std::filesystem::path path = UserCacheDirectory();
+        if (path.empty() || !CreatePrivateDirectory(path))
+        {
+            LOG_ERROR("[HEImGui] font cache directory unavailable, fonts are decompressed on every launch");
+            return {};
         }
+
+        return path;
     }
 
-    nvrhi::IGraphicsPipeline* GetPSO(nvrhi::IFramebuffer* fb)
+    // Creates 'path' (which must not exist) and writes 'data' to it
+    static bool WriteNewFile(const std::filesystem::path& path, std::span<const uint8_t> data)
     {
-        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+#ifdef _WIN32
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+
+        bool ok = true;
+        for (size_t offset = 0; ok && offset < data.size();)
+        {
+            DWORD written = 0;
+            const DWORD chunk = DWORD(std::min<size_t>(data.size() - offset, 1u << 30));
+            ok = WriteFile(file, data.data() + offset, chunk, &written, nullptr) && written;
+            offset += written;
+        }
+
+        return CloseHandle(file) && ok;
+#else
+        const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (fd < 0)
+            return false;
 
-        if (pso) return pso;
+        bool ok = true;
+        for (size_t offset = 0; ok && offset < data.size();)
+        {
+            const ssize_t written = write(fd, data.data() + offset, data.size() - offset);
+            if (written < 0 && errno == EINTR)
+                continue;
 
-        pso = device->createGraphicsPipeline(basePSODesc, fb->getFramebufferInfo());
-        CORE_ASSERT(pso);
+            ok = written > 0;
+            offset += ok ? size_t(written) : 0;
+        }
 
-        return pso;
+        return close(fd) == 0 && ok;
+#endif
     }
 
-    nvrhi::IBindingSet* GetBindingSet(nvrhi::ITexture* texture)
+    // Decompressed TTF for an embedded compressed font, valid as long as the cache lives.
+    // Returns an empty span when the data is corrupt.
+    std::span<const uint8_t> Get(const char* name, const void* compressedData, size_t compressedSize)
     {
-        if (bindingsCache.contains(texture))
-            return bindingsCache.at(texture);
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        const uint8_t* compressed = (const uint8_t*)compressedData;
+        const uint64_t hash = Hash(compressed, compressedSize);
+
+        auto [it, inserted] = entries.try_emplace(hash);
+        if (!inserted)
+            return View(*it->second);
+
+        it->second = std::make_unique<Entry>();
+        Entry& entry = *it->second;
 
-        for (auto it = bindingsCache.begin(); it != bindingsCache.end();)
+        const uint32_t size = StbDecompressor::DecompressedSize(compressed);
+        const uint32_t checksum = StbDecompressor::Checksum(compressed, compressedSize);
+        const std::filesystem::path path = directory.empty() ? std::filesystem::path() : directory / std::format("{}-{:016x}.ttf", name, hash);
+
+        if (!path.empty() && entry.file.Open(path) && IsValid(entry.file, size, checksum))
         {
-            if (it->first->GetRefCount() == 1)
-                it = bindingsCache.erase(it);
-            else
-                ++it;
+            hits++;
+            return View(entry);
         }
 
-        nvrhi::BindingSetDesc desc;
+        entry.file.Close();
+        misses++;
 
-        desc.bindings = {
-            nvrhi::BindingSetItem::PushConstants(0, sizeof(PushConstants)),
-            nvrhi::BindingSetItem::Texture_SRV(0, texture),
-            nvrhi::BindingSetItem::Sampler(0, fontSampler)
-        };
+        std::vector<uint8_t> decompressed(size);
+        StbDecompressor decompressor;
+        if (!decompressor.Decompress(decompressed.data(), compressed))
+        {
+            LOG_ERROR("[HEImGui] failed to decompress embedded font {}", name);
+            entries.erase(it);
+            return {};
+        }
+
+        if (!path.empty())
+        {
+            // written under a unique temporary name and renamed over whatever was there, so a crash never leaves a
+            // truncated font behind and a bad file gets replaced
+            std::error_code ec;
+            const std::filesystem::path tempPath = std::filesystem::path(path).concat(std::format(".{}-{}.tmp", ProcessId(), tempCounter++));
+            if (WriteNewFile(tempPath, decompressed))
+                std::filesystem::rename(tempPath, path, ec);
+            else
+                ec = std::make_error_code(std::errc::io_error);
 
-        nvrhi::BindingSetHandle binding = device->createBindingSet(desc, bindingLayout);
-        CORE_ASSERT(binding);
+            if (ec)
+                std::filesystem::remove(tempPath, ec);
+            else if (entry.file.Open(path) && IsValid(entry.file, size, checksum))
+                return View(entry);
 
-        bindingsCache[texture] = binding;
+            entry.file.Close();
+        }
 
-        return binding;
+        entry.memory = std::move(decompressed);
+        return View(entry);
     }
 
-    bool UpdateGeometry(ImDrawData* drawData, nvrhi::ICommandList* commandList)
+    static bool IsValid(const MappedFile& file, uint32_t size, uint32_t checksum)
     {
-        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+        return file.size == size && StbDecompressor::Adler32(file.data, size) == checksum;
+    }
 
-        // create/resize vertex and index buffers if needed
-        if (!ReallocateBuffer(vertexBuffer, drawData->TotalVtxCount * sizeof(ImDrawVert), (drawData->TotalVtxCount + 5000) * sizeof(ImDrawVert), false))
-            return false;
+    static uint32_t ProcessId()
+    {
+#ifdef _WIN32
+        return uint32_t(GetCurrentProcessId());
+#else
+        return uint32_t(getpid());
+#endif
+    }
+
+    static std::span<const uint8_t> View(const Entry& entry)
+    {
+        if (entry.file.data)
+            return { entry.file.data, entry.file.size };
 
+        return { entry.memory.data(), entry.memory.size() };
+    }
+};
 
-        if (!ReallocateBuffer(indexBuffer, drawData->TotalIdxCount * sizeof(ImDrawIdx), (drawData->TotalIdxCount + 5000) * sizeof(ImDrawIdx), true))
-            return false;
+enum class EmbeddedFont : uint8_t
+{
+    OpenSansRegular,
+    OpenSansBold,
+    FontAwesomeRegular,
+    FontAwesomeSolid,
 
-        vtxBuffer.resize(vertexBuffer->getDesc().byteSize / sizeof(ImDrawVert));
-        idxBuffer.resize(indexBuffer->getDesc().byteSize / sizeof(ImDrawIdx));
+    Count
+};
 
-        // copy and convert all vertices into a single contiguous buffer
-        ImDrawVert* vtxDst = &vtxBuffer[0];
-        ImDrawIdx* idxDst = &idxBuffer[0];
+// Every embedded font is decompressed (or mapped) once, on first use, and shared by every config that uses it.
+// With HE_IMGUI_RAW_FONTS (premake --heimgui-raw-fonts) the fonts are embedded uncompressed and used in place,
+// with HE_IMGUI_ICON_SUBSET (premake --heimgui-icon-manifest) the icon fonts are raw subsets.
+#define HE_RAW_FONT_BLOB(name, symbol) { name, symbol##_data, symbol##_size, false }
+#define HE_COMPRESSED_FONT_BLOB(name, symbol) { name, symbol##_compressed_data, symbol##_compressed_size, true }
 
-        for (int n = 0; n < drawData->CmdListsCount; n++)
-        {
-            const ImDrawList* cmdList = drawData->CmdLists[n];
+#ifdef HE_IMGUI_RAW_FONTS
+#define HE_TEXT_FONT_BLOB HE_RAW_FONT_BLOB
+#else
+#define HE_TEXT_FONT_BLOB HE_COMPRESSED_FONT_BLOB
+#endif
 
-            memcpy(vtxDst, cmdList->VtxBuffer.Data, cmdList->VtxBuffer.Size * sizeof(ImDrawVert));
-            memcpy(idxDst, cmdList->IdxBuffer.Data, cmdList->IdxBuffer.Size * sizeof(ImDrawIdx));
+#if defined(HE_IMGUI_ICON_SUBSET) || defined(HE_IMGUI_RAW_FONTS)
+#define HE_ICON_FONT_BLOB HE_RAW_FONT_BLOB
+#else
+#define HE_ICON_FONT_BLOB HE_COMPRESSED_FONT_BLOB
+#endif
 
-            vtxDst += cmdList->VtxBuffer.Size;
-            idxDst += cmdList->IdxBuffer.Size;
-        }
+struct EmbeddedFontRegistry
+{
+    struct Blob
+    {
+        const char* name;
+        const void* data;
+        size_t size;
+        bool compressed;
+    };
 
-        commandList->writeBuffer(vertexBuffer, &vtxBuffer[0], vertexBuffer->getDesc().byteSize);
-        commandList->writeBuffer(indexBuffer, &idxBuffer[0], indexBuffer->getDesc().byteSize);
+    static constexpr Blob c_Blobs[] = {
+        HE_TEXT_FONT_BLOB("OpenSans-Regular", OpenSans_Regular),
+        HE_TEXT_FONT_BLOB("OpenSans-Bold", OpenSans_Bold),
+        HE_ICON_FONT_BLOB("fa-regular-400", fa_regular_400),
+        HE_ICON_FONT_BLOB("fa-solid-900", fa_solid_900),
+    };
 
-        return true;
+#ifdef HE_IMGUI_ICON_SUBSET
+    static constexpr const ImWchar* c_IconRanges = c_IconGlyphRanges;
+#else
+    static constexpr const ImWchar* c_IconRanges = nullptr; // every glyph of the icon fonts
+#endif
+
+    static_assert(std::size(c_Blobs) == size_t(EmbeddedFont::Count));
+
+    FontCache cache;
+    std::array<std::span<const uint8_t>, size_t(EmbeddedFont::Count)> views;
+
+    std::span<const uint8_t> Get(EmbeddedFont font)
+    {
+        std::span<const uint8_t>& view = views[size_t(font)];
+        if (view.empty())
+        {
+            const Blob& blob = c_Blobs[size_t(font)];
+            if (blob.compressed)
+                view = cache.Get(blob.name, blob.data, blob.size);
+            else
+                view = { (const uint8_t*)blob.data, blob.size };
+        }
+
+        return view;
     }
 };
 
@@ -485,6 +3664,7 @@ struct ImGuiBackend
 struct ViewportData
 {
     Scope<SwapChain> sc;
+    ImGuiBackend::RenderContext context;
 };
 
 struct ImGuiLayer : public Layer
@@ -492,6 +3672,19 @@ struct ImGuiLayer : public Layer
     nvrhi::DeviceHandle device;
     bool blockEvents = true;
     ImGuiBackend imGuiBackend;
+    std::vector<ImGuiBackend::ViewportTarget> viewportTargets;
+    EmbeddedFontRegistry embeddedFonts; // outlives the ImGui context, the atlas points into it
+    std::array<ImFont*, size_t(HEImGui::Font::Count)> fonts = {};
+    ImGuiStyle baseStyle; // Theme() at scale 1, every content scale starts over from it
+
+    // Settings::idleThrottling and Settings::decoupledUIUpdates
+    using Clock = std::chrono::steady_clock;
+
+    bool minimized = false; // the main window is iconified or hidden, its UI isn't rendered
+    Clock::time_point lastActivity;
+    Clock::time_point lastInteraction; // activity other than animation requests
+    Clock::time_point lastFrameStart;
+    Clock::time_point lastUIFrame;
 
     ImGuiLayer(nvrhi::DeviceHandle pDevice) :device(pDevice) {}
 
@@ -582,45 +3775,71 @@ struct ImGuiLayer : public Layer
         style.FrameBorderSize = 0.0f;
     }
 
-    void CreateDefultFont(ImVec2 scale)
+    ImFont* AddEmbeddedFont(EmbeddedFont font, ImFontConfig& config)
     {
-        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+        std::span<const uint8_t> ttf = embeddedFonts.Get(font);
+        if (ttf.empty())
+            return nullptr;
 
-        ImGuiIO& io = ImGui::GetIO();
+        // the cache owns the bytes, ImGui only reads them
+        config.FontDataOwnedByAtlas = false;
+        return ImGui::GetIO().Fonts->AddFontFromMemoryTTF((void*)ttf.data(), int(ttf.size()), 0, &config);
+    }
+
+    // Text font with the icon fonts merged in
+    ImFont* AddTextFont(EmbeddedFont textFont, const char* name)
+    {
+        const float fontSize = 16.0f;
+
+        ImFontConfig config;
+        config.SizePixels = fontSize; // DPI scaling happens at bake time through style.FontScaleDpi
+        strcpy_s(config.Name, name);
+        ImFont* font = AddEmbeddedFont(textFont, config);
+
+        // Icons Fonts
+        config.MergeMode = true;
+        config.GlyphMinAdvanceX = 13.0f;
+        config.GlyphOffset = ImVec2(1.0f, 1.0f);
+        config.GlyphRanges = EmbeddedFontRegistry::c_IconRanges;
+        AddEmbeddedFont(EmbeddedFont::FontAwesomeRegular, config);
+        AddEmbeddedFont(EmbeddedFont::FontAwesomeSolid, config);
+
+        return font;
+    }
+
+    // Fonts other than the default one are added the first time they are asked for
+    ImFont* GetFont(HEImGui::Font font)
+    {
+        ImFont*& loaded = fonts[size_t(font)];
+        if (loaded)
+            return loaded;
 
-        float fontSize = 16.0f;
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
 
+        switch (font)
         {
-            ImFontConfig config;
+        case HEImGui::Font::Regular: loaded = AddTextFont(EmbeddedFont::OpenSansRegular, "OpenSans-Regular + icons"); break;
+        case HEImGui::Font::Bold:    loaded = AddTextFont(EmbeddedFont::OpenSansBold, "OpenSans-Bold"); break;
+        default: break;
+        }
 
-            config.FontDataOwnedByAtlas = false;
-            config.SizePixels = fontSize * scale.x;
-            strcpy_s(config.Name, "OpenSans-Regular + icons");
-            io.FontDefault = io.Fonts->AddFontFromMemoryCompressedTTF((void*)OpenSans_Regular_compressed_data, OpenSans_Regular_compressed_size, 0, &config);
+        return loaded;
+    }
 
+    void CreateDefultFont()
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
 
-            // Icons Fonts
-            config.MergeMode = true;
-            config.GlyphMinAdvanceX = 13.0f;
-            config.GlyphOffset = ImVec2(1.0f, 1.0f);
-            io.Fonts->AddFontFromMemoryCompressedTTF((void*)fa_regular_400_compressed_data, fa_regular_400_compressed_size, 0, &config);
-            io.Fonts->AddFontFromMemoryCompressedTTF((void*)fa_solid_900_compressed_data, fa_solid_900_compressed_size, 0, &config);
-        }
+        const auto start = std::chrono::steady_clock::now();
+        const uint32_t hits = embeddedFonts.cache.hits;
+        const uint32_t misses = embeddedFonts.cache.misses;
 
-        {
-            ImFontConfig config;
-            config.FontDataOwnedByAtlas = false;
-            config.SizePixels = fontSize * scale.x;
-            strcpy_s(config.Name, "OpenSans-Bold");
-            io.Fonts->AddFontFromMemoryCompressedTTF((void*)OpenSans_Bold_compressed_data, OpenSans_Bold_compressed_size, 0, &config);
+        fonts = {};
+        ImGui::GetIO().FontDefault = GetFont(HEImGui::Font::Regular);
 
-            // Icons Fonts
-            config.MergeMode = true;
-            config.GlyphMinAdvanceX = 13.0f;
-            config.GlyphOffset = ImVec2(1.0f, 1.0f);
-            io.Fonts->AddFontFromMemoryCompressedTTF((void*)fa_regular_400_compressed_data, fa_regular_400_compressed_size, 0, &config);
-            io.Fonts->AddFontFromMemoryCompressedTTF((void*)fa_solid_900_compressed_data, fa_solid_900_compressed_size, 0, &config);
-        }
+        // cold starts decompress and write the cache, warm starts only map it, fonts already loaded cost nothing
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        LOG_INFO("[HEImGui] default fonts loaded in {:.2f} ms ({} mapped from cache, {} decompressed)", ms, embeddedFonts.cache.hits - hits, embeddedFonts.cache.misses - misses);
     }
 
     void OnAttach() override
@@ -633,7 +3852,7 @@ struct ImGuiLayer : public Layer
         auto [sx, sy] = w.GetWindowContentScale();
 
         ImGuiIO& io = ImGui::GetIO();
-        io.BackendRendererUserData = &imGuiBackend;
+        io.BackendRendererUserData = static_cast<HEImGui::Context*>(&imGuiBackend);
         io.BackendRendererName = "HEImGui-NVRHI";
         io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
         io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;
@@ -644,6 +3863,8 @@ struct ImGuiLayer : public Layer
         io.BackendFlags |= ImGuiBackendFlags_RendererHasViewports;
         io.BackendFlags |= ImGuiBackendFlags_PlatformHasViewports;
         io.ConfigDockingTransparentPayload = true;
+        io.ConfigDpiScaleFonts = true;     // each viewport's text follows the DPI of its monitor
+        io.ConfigDpiScaleViewports = true; // and platform windows resize when moved to a monitor with another DPI
         //io.ConfigViewportsNoDecoration = false;
 
         GLFWwindow* window = static_cast<GLFWwindow*>(w.handle);
@@ -689,12 +3910,12 @@ struct ImGuiLayer : public Layer
                 CORE_PROFILE_SCOPE_NC("Renderer_RenderWindow", HE_PROFILE_IMGUI);
 
                 ViewportData* data = (ViewportData*)viewport->RendererUserData;
-                ImGuiBackend* imGuiBackend = (ImGuiBackend*)ImGui::GetIO().BackendRendererUserData;
+                ImGuiBackend* imGuiBackend = static_cast<ImGuiBackend*>((HEImGui::Context*)ImGui::GetIO().BackendRendererUserData);
 
                 data->sc->UpdateSize();
                 data->sc->BeginFrame();
 
-                imGuiBackend->Render(viewport->DrawData, data->sc->GetCurrentFramebuffer());
+                imGuiBackend->Render(viewport->DrawData, data->sc->GetCurrentFramebuffer(), data->context);
             };
 
             platform_io.Renderer_SwapBuffers = [](ImGuiViewport* viewport, void*) {
@@ -706,10 +3927,36 @@ struct ImGuiLayer : public Layer
             };
         }
 
-        imGuiBackend.Init(device);
+        // secondary viewports create their swap chains from the same description, so this covers them too
+        const SwapChainDesc& swapChainDesc = w.desc.swapChainDesc;
+        nvrhi::FramebufferInfo mainFramebufferInfo;
+        mainFramebufferInfo.colorFormats.push_back(swapChainDesc.swapChainFormat);
+        mainFramebufferInfo.sampleCount = swapChainDesc.swapChainSampleCount;
+        mainFramebufferInfo.sampleQuality = swapChainDesc.swapChainSampleQuality;
+
+        imGuiBackend.Init(device, mainFramebufferInfo);
 
         Theme();
-        CreateDefultFont(sx);
+
+        imGuiBackend.getFont = [this](HEImGui::Font font) { return GetFont(font); };
+
+        embeddedFonts.cache.directory = FontCache::PrivateDirectory();
+        CreateDefultFont();
+
+        baseStyle = ImGui::GetStyle();
+        ApplyContentScale(sx);
+    }
+
+    // Fonts are sized at bake time, glyphs for a new scale get baked on demand as they are drawn: a DPI change only
+    // rescales the style. Text follows the viewports on its own, ConfigDpiScaleFonts sets FontScaleDpi from the DPI
+    // of the monitor each window is on.
+    void ApplyContentScale(float scale)
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        ImGuiStyle& style = ImGui::GetStyle();
+        style = baseStyle;
+        style.ScaleAllSizes(scale);
     }
 
     void OnDetach() override
@@ -730,6 +3977,33 @@ struct ImGuiLayer : public Layer
         ImGui::DestroyContext();
     }
 
+    // ImGuiFreeTypeLoaderFlags_LoadColor, imgui_freetype.h isn't part of this build
+    static constexpr unsigned int c_FontLoaderLoadColor = 1u << 8;
+
+    // Fonts loaded with color glyphs need RGBA32 whatever the settings say
+    static bool AtlasHasColorFonts(const ImFontAtlas* atlas)
+    {
+        for (const ImFontConfig& source : atlas->Sources)
+            if ((source.FontLoaderFlags | atlas->FontLoaderFlags) & c_FontLoaderLoadColor)
+                return true;
+
+        return false;
+    }
+
+    // The atlas keeps its fonts, only the baked glyphs are dropped and rebaked in the new format
+    void UpdateFontAtlasFormat()
+    {
+        ImFontAtlas* atlas = ImGui::GetIO().Fonts;
+
+        const bool alpha8 = imGuiBackend.settings.alpha8FontAtlas && !AtlasHasColorFonts(atlas);
+        const ImTextureFormat format = alpha8 ? ImTextureFormat_Alpha8 : ImTextureFormat_RGBA32;
+        if (atlas->TexDesiredFormat == format)
+            return;
+
+        atlas->TexDesiredFormat = format;
+        ImFontAtlasBuildClear(atlas);
+    }
+
     void OnBegin(const FrameInfo& info) override
     {
         CORE_PROFILE_SCOPE_NC("ImGuiLayer::OnBegin", HE_PROFILE_IMGUI);
@@ -737,24 +4011,133 @@ struct ImGuiLayer : public Layer
         ImGuiIO& io = ImGui::GetIO();
         auto& w = Application::GetWindow();
 
+        GLFWwindow* window = static_cast<GLFWwindow*>(w.handle);
+        minimized = glfwGetWindowAttrib(window, GLFW_ICONIFIED) || !glfwGetWindowAttrib(window, GLFW_VISIBLE);
+
+        UpdateActivity();
+
+        // the host owns its loop: a minimized window only skips the UI rendering unless throttling was asked for
+        if (imGuiBackend.settings.idleThrottling)
+            ThrottleIdle();
+
+        // frames between UI updates leave ImGui alone, the input the callbacks queue waits for the next NewFrame
+        imGuiBackend.uiFrame = ShouldUpdateUI(w.GetWidth(), w.GetHeight());
+        if (!imGuiBackend.uiFrame)
+            return;
+
+        lastUIFrame = Clock::now();
+
         io.DisplaySize = ImVec2((float)w.GetWidth(), (float)w.GetHeight());
+        UpdateFontAtlasFormat();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
         ImGuizmo::BeginFrame();
     }
 
+    // Runs before the platform backend queues this frame's polled input: anything already in the queue came from
+    // window callbacks since the last frame. Input, an active item or a texture request count as interaction,
+    // animation requests only as activity: they keep the loop at full rate, not the UI updates.
+    void UpdateActivity()
+    {
+        const ImGuiContext& g = *GImGui;
+        const Clock::time_point now = Clock::now();
+
+        bool interacting = g.InputEventsQueue.Size > 0 || g.ActiveId != 0;
+        for (const ImTextureData* tex : ImGui::GetPlatformIO().Textures)
+            interacting |= tex->Status != ImTextureStatus_OK;
+
+        if (interacting)
+            lastInteraction = now;
+
+        if (interacting || ImGui::GetTime() < imGuiBackend.animateUntil)
+            lastActivity = now;
+    }
+
+    // Blocking in glfwWaitEventsTimeout dispatches the window callbacks too, so input that ends the wait is queued
+    // like any other and nothing is lost.
+    void ThrottleIdle()
+    {
+        CORE_PROFILE_SCOPE_COLOR(HE_PROFILE_IMGUI);
+
+        const ImGuiContext& g = *GImGui;
+        const HEImGui::Settings& settings = imGuiBackend.settings;
+        const Clock::time_point now = Clock::now();
+
+        const bool idle = minimized || now - lastActivity >= std::chrono::duration<float>(settings.idleDelay);
+        if (idle)
+        {
+            const std::chrono::duration<double> interval(1.0 / std::max(settings.idleRefreshRate, 0.1f));
+            const double timeout = (interval - (now - lastFrameStart)).count();
+
+            if (timeout > 0.0)
+            {
+                glfwWaitEventsTimeout(timeout);
+                imGuiBackend.totals.idleFrames++;
+
+                if (g.InputEventsQueue.Size > 0)
+                    lastActivity = lastInteraction = Clock::now();
+            }
+        }
+
+        lastFrameStart = Clock::now();
+    }
+
+    // Settings::decoupledUIUpdates: the UI is rebuilt at 'uiUpdateRate', or 'uiInteractiveUpdateRate' within 'idleDelay'
+    // of the last interaction. Always rebuilt when the cache holds nothing, or the window was resized since.
+    bool ShouldUpdateUI(uint32_t width, uint32_t height) const
+    {
+        const HEImGui::Settings& settings = imGuiBackend.settings;
+        const ImVec2& displaySize = ImGui::GetIO().DisplaySize;
+        if (!settings.decoupledUIUpdates || minimized || !imGuiBackend.uiCache.valid || displaySize.x != float(width) || displaySize.y != float(height))
+            return true;
+
+        const Clock::time_point now = Clock::now();
+        const bool interacting = now - lastInteraction < std::chrono::duration<float>(settings.idleDelay);
+        const float rate = interacting ? settings.uiInteractiveUpdateRate : settings.uiUpdateRate;
+        if (rate <= 0.0f)
+            return true;
+
+        return now - lastUIFrame >= std::chrono::duration<double>(1.0 / rate);
+    }
+
     void OnEnd(const FrameInfo& info) override
     {
         CORE_PROFILE_SCOPE_NC("ImGuiLayer::OnEnd", HE_PROFILE_IMGUI);
 
+        ImGuiIO& io = ImGui::GetIO();
+        const HEImGui::Settings& settings = imGuiBackend.settings;
+
+        // the last UI over the new scene, platform windows keep what they presented last
+        if (!imGuiBackend.uiFrame)
+        {
+            imGuiBackend.NewFrame();
+            imGuiBackend.CompositeUICache(info.fb, imGuiBackend.mainContext);
+            return;
+        }
+
         {
             BUILTIN_PROFILE_CPU("ImGui");
             ImGui::Render();
-            imGuiBackend.Render(ImGui::GetMainViewport()->DrawData, info.fb);
-        }
+            imGuiBackend.NewFrame();
 
-        ImGuiIO& io = ImGui::GetIO();
+            // decoupled updates need the main viewport in the cache, so its platform windows render one by one
+            if (settings.viewportSubmission != HEImGui::ViewportSubmission::PerViewport && !settings.decoupledUIUpdates &&
+                (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable))
+            {
+                RenderAllViewports(minimized ? nullptr : info.fb);
+                return;
+            }
+
+            if (minimized)
+                imGuiBackend.SubmitTextures();
+            else if (settings.decoupledUIUpdates)
+                imGuiBackend.RenderCached(ImGui::GetMainViewport()->DrawData, info.fb, imGuiBackend.mainContext, true);
+            else if (settings.cacheUI)
+                imGuiBackend.RenderCached(ImGui::GetMainViewport()->DrawData, info.fb, imGuiBackend.mainContext);
+            else
+                imGuiBackend.Render(ImGui::GetMainViewport()->DrawData, info.fb, imGuiBackend.mainContext);
+        }
 
         if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
         {
@@ -770,6 +4153,60 @@ struct ImGuiLayer : public Layer
         }
     }
 
+    // RenderPlatformWindowsDefault with the rendering pulled out: every viewport, the main one included, is handed
+    // to the backend at once and submitted in one go before the presents.
+    void RenderAllViewports(nvrhi::IFramebuffer* mainFramebuffer)
+    {
+        CORE_PROFILE_SCOPE_NC("ImGuiLayer::RenderAllViewports", HE_PROFILE_IMGUI);
+
+        {
+            CORE_PROFILE_SCOPE_NC("ImGui::UpdatePlatformWindows", HE_PROFILE_IMGUI);
+            ImGui::UpdatePlatformWindows();
+        }
+
+        ImGuiPlatformIO& platformIO = ImGui::GetPlatformIO();
+
+        // no main framebuffer while the main window is minimized, platform windows still render
+        viewportTargets.clear();
+        if (mainFramebuffer)
+            viewportTargets.push_back({ &imGuiBackend.mainContext, ImGui::GetMainViewport()->DrawData, mainFramebuffer });
+
+        for (int i = 1; i < platformIO.Viewports.Size; i++)
+        {
+            ImGuiViewport* viewport = platformIO.Viewports[i];
+            if (viewport->Flags & ImGuiViewportFlags_IsMinimized)
+                continue;
+
+            if (platformIO.Platform_RenderWindow)
+                platformIO.Platform_RenderWindow(viewport, nullptr);
+
+            ViewportData* data = (ViewportData*)viewport->RendererUserData;
+            data->sc->UpdateSize();
+            data->sc->BeginFrame();
+
+            viewportTargets.push_back({ &data->context, viewport->DrawData, data->sc->GetCurrentFramebuffer() });
+        }
+
+        if (viewportTargets.empty())
+            imGuiBackend.SubmitTextures();
+        else if (imGuiBackend.settings.viewportSubmission == HEImGui::ViewportSubmission::Batched)
+            imGuiBackend.RenderViewportsBatched(viewportTargets.data(), uint32_t(viewportTargets.size()));
+        else
+            imGuiBackend.RenderViewports(viewportTargets.data(), uint32_t(viewportTargets.size()));
+
+        for (int i = 1; i < platformIO.Viewports.Size; i++)
+        {
+            ImGuiViewport* viewport = platformIO.Viewports[i];
+            if (viewport->Flags & ImGuiViewportFlags_IsMinimized)
+                continue;
+
+            if (platformIO.Platform_SwapBuffers)
+                platformIO.Platform_SwapBuffers(viewport, nullptr);
+
+            platformIO.Renderer_SwapBuffers(viewport, nullptr);
+        }
+    }
+
     void OnEvent(Event& e) override
     {
         CORE_PROFILE_SCOPE_NC("ImGuiLayer::OnEvent", HE_PROFILE_IMGUI);
@@ -783,15 +4220,13 @@ struct ImGuiLayer : public Layer
 
         DispatchEvent<WindowContentScaleEvent>(e, [this](WindowContentScaleEvent& e) {
 
-            ImGuiIO& io = ImGui::GetIO();
-            io.DisplayFramebufferScale = { e.scaleX, e.scaleY };
+            // the GLFW backend updates DisplayFramebufferScale every frame from the window's framebuffer size
+            const auto start = std::chrono::steady_clock::now();
 
-            io.Fonts->Clear();
-            CreateDefultFont({ e.scaleX, e.scaleY });
+            ApplyContentScale(e.scaleX);
 
-            ImGui::GetStyle() = ImGuiStyle();
-            ImGui::GetStyle().ScaleAllSizes(e.scaleX);
-            Theme();
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            LOG_TRACE("[HEImGui] content scale {:.2f} applied in {:.3f} ms", e.scaleX, ms);
 
             return false;
         });
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <imgui.h>
+#include <nvrhi/nvrhi.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////
+// HEImGui
+//////////////////////////////////////////////////////////////////////////
+
+namespace HEImGui {
+
+    enum class GeometryUpload : uint8_t
+    {
+        WriteBuffer, // draw lists are gathered into a CPU copy and written to device-local buffers
+        MappedRing,  // draw lists are copied straight into mapped CPU-visible buffers, one set per frame in flight (D3D12/Vulkan)
+    };
+
+    enum class ViewportSubmission : uint8_t
+    {
+        PerViewport, // each viewport uploads, records and submits on its own, through RenderPlatformWindowsDefault
+        Batched,     // all viewports share one geometry upload and one command list, submitted once before the presents
+        Parallel,    // each viewport records its own command list on a worker thread, all submitted once before the presents
+    };
+
+    struct Settings
+    {
+        // Merge adjacent draw commands that share a texture, a scissor rect and a contiguous index range.
+        bool mergeDrawCommands = true;
+
+        GeometryUpload geometryUpload = GeometryUpload::WriteBuffer;
+
+        // GeometryUpload::WriteBuffer: keep every draw list at a stable place in the geometry buffers and only upload
+        // the lists whose content changed. The buffers are repacked once more than 'geometryCompactionThreshold' of
+        // their used range is free.
+        bool incrementalGeometryUpload = false;
+        float geometryCompactionThreshold = 0.5f;
+
+        // Bake the font atlas as Alpha8 (an R8 texture) instead of RGBA32, a quarter of the memory and uploads.
+        // Atlases with fonts loaded with color glyphs stay RGBA32. Custom rects can't be told apart from baked
+        // glyphs, leave this off when they hold color: Alpha8 drops it.
+        bool alpha8FontAtlas = false;
+
+        // Draw every texture from one descriptor table instead of one binding set per texture.
+        // Ignored where bindless isn't supported (D3D11, devices without descriptor indexing).
+        // The table takes 'bindlessTextureCapacity' descriptors from the heap shared with the host. It is created once,
+        // at the start of the first frame with bindlessTextures on, and never resized: textures beyond it fall back
+        // to binding sets.
+        bool bindlessTextures = false;
+        uint32_t bindlessTextureCapacity = 4096;
+
+        // Texture binding cache: entries visited by the eviction sweep per frame, and frames
+        // without a draw after which an entry is dropped even though its texture is still alive.
+        uint32_t bindingCacheScanPerFrame = 32;
+        uint32_t bindingCacheStaleFrames = 600;
+
+        // Framebuffer layouts ImGui may render to besides the main swap chain. The settings only exist once the plugin
+        // is attached, so entries are compiled at the start of the frame after they were added, never while recording.
+        // Declare them before the first frame that renders to them.
+        std::vector<nvrhi::FramebufferInfo> prewarmFramebuffers;
+
+        // Viewports with at least 'parallelRecordThreshold' draw commands are recorded in chunks of at least
+        // 'parallelRecordMinBatchesPerChunk' draws, each into its own command list on a worker thread.
+        // 0 disables it. D3D11 records on the calling thread. A viewport whose draw data has user callbacks is never
+        // chunked, and when several viewports record in parallel it is recorded on the calling thread on its own.
+        uint32_t parallelRecordThreshold = 0;
+        uint32_t parallelRecordMinBatchesPerChunk = 256;
+        uint32_t parallelRecordMaxThreads = 3;
+
+        // Alternates single and multi-threaded recording every frame and periodically logs the average
+        // recording time per draw count, to find where the threshold should be on a given machine.
+        bool parallelRecordBenchmark = false;
+
+        // How the main viewport and the platform windows are submitted when multi-viewports are enabled.
+        ViewportSubmission viewportSubmission = ViewportSubmission::PerViewport;
+
+        // Vertex/index buffer capacity, in vertices or indices. Buffers grow geometrically within [min, max] and
+        // are shrunk after 'bufferShrinkFrames' frames in a row below capacity / growth^2.
+        uint32_t minBufferElements = 5000;
+        uint32_t maxBufferElements = 1 << 20;
+        float bufferGrowthFactor = 1.5f;
+        uint32_t bufferShrinkFrames = 300;
+
+        // Render the main viewport into an offscreen texture and only composite it onto the framebuffer while its
+        // draw data and textures are unchanged. Only applies with ViewportSubmission::PerViewport.
+        bool cacheUI = false;
+
+        // Frames drawing user textures (ImTextureIDs not created by ImGui) bypass the cache, the backend can't see their
+        // content change. Set this when those textures are static, or call InvalidateUICache() whenever one changes.
+        // Window layers follow the same rule.
+        bool uiCacheStaticUserTextures = false;
+
+        // Side of the texture the window layers of a viewport are packed into, see CacheWindowLayer()
+        uint32_t windowLayerAtlasSize = 2048;
+
+        // Once 'idleDelay' seconds passed without input, active items, pending texture updates or RequestAnimation(),
+        // each frame blocks on window events until 1 / 'idleRefreshRate' seconds after the previous one, so an idle
+        // tool redraws at that rate instead of the display's. This throttles the whole application loop: scenes that
+        // animate on their own call RequestAnimation(). A minimized or hidden main window counts as idle right away.
+        // Its UI is never rendered while minimized, throttling or not.
+        bool idleThrottling = false;
+        float idleRefreshRate = 10.0f;
+        float idleDelay = 1.0f;
+
+        // Rebuild the UI (ImGui::NewFrame to ImGui::Render) at most 'uiUpdateRate' times per second, or at
+        // 'uiInteractiveUpdateRate' within 'idleDelay' of the last input (0: every frame). Animation requests don't
+        // count as input. Frames in between composite the last main viewport UI over the scene and skip ImGui
+        // entirely: UI code must check IsUIFrame(). The main viewport always goes through the UI cache and platform
+        // windows render with ViewportSubmission::PerViewport.
+        bool decoupledUIUpdates = false;
+        float uiUpdateRate = 30.0f;
+        float uiInteractiveUpdateRate = 0.0f;
+    };
+
+    struct FrameStats
+    {
+        uint32_t drawCommands = 0;      // ImDrawCmds submitted by ImGui (user callbacks excluded)
+        uint32_t drawCalls = 0;         // drawIndexed calls issued by the backend
+        uint32_t mergedDrawCalls = 0;   // draw calls saved by merging adjacent commands
+        uint32_t stateChanges = 0;      // setGraphicsState calls
+        uint32_t bindingChanges = 0;    // state changes that switched the binding set
+        uint32_t scissorChanges = 0;    // state changes that moved the scissor rect
+        uint32_t pushConstantUpdates = 0;
+        uint64_t uploadBytes = 0;       // vertex and index bytes uploaded
+        uint64_t uploadSkippedBytes = 0; // vertex and index bytes of unchanged draw lists left in place (incremental upload)
+        uint64_t vertexBufferBytes = 0; // vertex buffer capacity in use this frame
+        uint64_t indexBufferBytes = 0;  // index buffer capacity in use this frame
+        uint32_t bindingCacheHits = 0;
+        uint32_t bindingCacheMisses = 0;
+        uint32_t bindingCacheEvictions = 0;
+        uint32_t bindingCacheSize = 0;
+        uint32_t textureUploads = 0;    // texture regions copied from the staging pages
+        uint64_t textureUploadBytes = 0; // texture bytes uploaded, texture creation included
+        uint64_t textureUploadTexels = 0; // texels copied by texture updates, texture creation excluded
+        uint64_t textureCopyTexels = 0; // texels a grown atlas took over from its previous texture on the GPU
+        uint64_t textureGrowUploadTexels = 0; // texels of a grown atlas that had to be uploaded, matching nothing in the old one
+        uint32_t pendingReleases = 0;   // resources waiting for the GPU to finish the frames that used them
+        uint32_t recordChunks = 0;      // command lists recorded, more than one per viewport when recording in parallel
+        double recordMicroseconds = 0.0; // CPU time spent recording draws
+        bool uiCacheHit = false;        // the main viewport was composited from the UI cache without redrawing
+        bool uiSkipped = false;         // no UI update this frame, the last one was composited (Settings::decoupledUIUpdates)
+        uint32_t windowLayers = 0;      // windows drawn as one quad from their layer
+        uint32_t windowLayerRedraws = 0; // of those, layers drawn again because their window changed
+    };
+
+    // Counters accumulated since the plugin was loaded
+    struct TotalStats
+    {
+        uint64_t bufferGrowths = 0;     // geometry buffers reallocated to grow (first allocations excluded)
+        uint64_t bufferShrinks = 0;     // geometry buffers released after staying well below capacity
+        uint64_t pipelineCacheMisses = 0; // pipelines compiled while recording, for undeclared framebuffer layouts
+        uint64_t geometryCompactions = 0; // incremental geometry laid out again from scratch, first layouts included
+        uint64_t idleFrames = 0;        // frames that blocked on window events (Settings::idleThrottling)
+        uint64_t uiCacheHits = 0;       // frames composited from the UI cache
+        uint64_t uiCacheMisses = 0;     // frames redrawn into the UI cache
+        uint64_t uiCacheBypasses = 0;   // frames that couldn't be cached (user callbacks, user textures, MSAA targets)
+        uint64_t uiSkippedFrames = 0;   // frames without a UI update that composited the last one (Settings::decoupledUIUpdates)
+    };
+
+    // Fonts of the default set, each with the icon fonts merged in
+    enum class Font : uint8_t
+    {
+        Regular, // io.FontDefault
+        Bold,
+
+        Count
+    };
+
+    // Shared between the plugin and its users through ImGuiIO::BackendRendererUserData.
+    struct Context
+    {
+        Settings settings;
+        FrameStats stats; // stats of the last rendered frame, all viewports included
+        TotalStats totals;
+        std::function<ImFont*(Font)> getFont;
+        bool invalidateUICache = false; // consumed by the next frame
+        std::vector<const ImDrawList*> windowLayerRequests; // CacheWindowLayer() calls of the frame being built
+        double animateUntil = 0.0; // ImGui::GetTime() until which idle throttling stays off
+        bool uiFrame = true;       // ImGui::NewFrame was called this frame
+    };
+
+    inline Context* GetContext() { return (Context*)ImGui::GetIO().BackendRendererUserData; }
+    inline Settings& GetSettings() { return GetContext()->settings; }
+    inline const FrameStats& GetFrameStats() { return GetContext()->stats; }
+    inline const TotalStats& GetTotalStats() { return GetContext()->totals; }
+
+    // Forces the next frame to redraw the UI cache, for content the backend can't track (static user textures that changed)
+    inline void InvalidateUICache() { GetContext()->invalidateUICache = true; }
+
+    // Between Begin() and End(): render the current window into a layer of its own that is only redrawn when its draw
+    // list changes, and drawn as a single quad otherwise. For mostly static panels next to busy ones. Applies to this
+    // frame only, call it every frame. Child windows have draw lists of their own and need their own call. Windows
+    // with user callbacks, or user textures unless Settings::uiCacheStaticUserTextures is set, are drawn as usual.
+    inline void CacheWindowLayer() { GetContext()->windowLayerRequests.push_back(ImGui::GetWindowDrawList()); }
+
+    // False on the frames Settings::decoupledUIUpdates skips, where no ImGui call may be made
+    inline bool IsUIFrame() { return GetContext()->uiFrame; }
+
+    // Keeps Settings::idleThrottling from slowing down frames for the next 'milliseconds', for anything that animates
+    // without input: spinners, progress bars, a scene playing. Calls extend each other, call it every frame to stay at full rate.
+    inline void RequestAnimation(float milliseconds)
+    {
+        Context* context = GetContext();
+        context->animateUntil = std::max(context->animateUntil, ImGui::GetTime() + double(milliseconds) / 1000.0);
+    }
+
+    // Share of the frames rendered with Settings::cacheUI that were composited without redrawing
+    inline float GetUICacheHitRate()
+    {
+        const TotalStats& totals = GetContext()->totals;
+        const uint64_t frames = totals.uiCacheHits + totals.uiCacheMisses + totals.uiCacheBypasses;
+        return frames ? float(double(totals.uiCacheHits) / double(frames)) : 0.0f;
+    }
+
+    // Loads the font on first use, from the UI thread. Fonts are added once at their base size, a DPI change
+    // doesn't reload them: glyphs are baked on demand at each viewport's scale.
+    inline ImFont* GetFont(Font font) { return GetContext()->getFont(font); }
+}
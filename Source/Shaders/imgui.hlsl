@@ -2,6 +2,8 @@ struct Constants
 {
     float2 scale;
     float2 translate;
+    uint textureIndex;
+    uint alpha8;
 };
 
 #ifdef SPIRV
@@ -43,3 +45,47 @@ float4 main_ps(PixelInput input) : SV_Target
 {
     return float4(pow(abs(input.color.rgb), 2.2), input.color.a) * texture0.Sample(sampler0, input.uv);
 }
+
+// Alpha8 font atlases are stored as R8, the coverage is broadcast as white with alpha.
+float4 main_ps_alpha8(PixelInput input) : SV_Target
+{
+    return float4(pow(abs(input.color.rgb), 2.2), input.color.a) * float4(1, 1, 1, texture0.Sample(sampler0, input.uv).r);
+}
+
+// Bindless variant, the texture comes from the descriptor table at g_Const.textureIndex.
+// DXBC has no unbounded arrays, D3D11 never uses this entry so it only gets the regular body.
+#if __SHADER_TARGET_MAJOR >= 6
+Texture2D t_BindlessTextures[] : register(t0, space1);
+#endif
+
+float4 main_ps_bindless(PixelInput input) : SV_Target
+{
+#if __SHADER_TARGET_MAJOR >= 6
+    Texture2D tex = t_BindlessTextures[g_Const.textureIndex];
+    float4 texel = tex.Sample(sampler0, input.uv);
+    if (g_Const.alpha8)
+        texel = float4(1, 1, 1, texel.r);
+    return float4(pow(abs(input.color.rgb), 2.2), input.color.a) * texel;
+#else
+    return main_ps(input);
+#endif
+}
+
+// UI cache and window layers: a full-screen triangle that blends premultiplied offscreen UI onto the framebuffer,
+// texel for texel. The scissor rect limits it to a window, g_Const.translate is where it sits in the layer atlas.
+float4 composite_vs(uint vertexID : SV_VertexID) : SV_POSITION
+{
+    float2 uv = float2((vertexID << 1) & 2, vertexID & 2);
+    return float4(uv * float2(2, -2) + float2(-1, 1), 0, 1);
+}
+
+float4 composite_ps(float4 position : SV_POSITION) : SV_Target
+{
+    return texture0.Load(int3(position.xy + g_Const.translate, 0));
+}
+
+// Clears the scissored region of a layer before it is redrawn
+float4 composite_clear_ps(float4 position : SV_POSITION) : SV_Target
+{
+    return 0;
+}
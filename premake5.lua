@@ -1,5 +1,24 @@
 IncludeDir["ImGui"] = "%{HE}/Plugins/HEImGui/imgui"
 
+newoption {
+    trigger = "heimgui-raw-fonts",
+    description = "HEImGui: embed the default fonts as raw TTF bytes, loaded with no inflate and no copy (larger binary)"
+}
+
+newoption {
+    trigger = "heimgui-python",
+    value = "PATH",
+    description = "HEImGui: Python 3 interpreter for the font generation steps (default: python on Windows, python3 elsewhere)"
+}
+
+newoption {
+    trigger = "heimgui-icon-manifest",
+    value = "PATH",
+    description = "HEImGui: subset the embedded icon fonts to the codepoints listed in PATH (needs Python 3 and fontTools)"
+}
+
+local heimguiPython = _OPTIONS["heimgui-python"] or (os.target() == "windows" and "python" or "python3")
+
 function Link.Plugin.ImGui()
 
     includedirs {
@@ -48,6 +67,18 @@ group "Plugins/imgui"
            "glfw",
         }
 
+        -- raw font headers are generated from the compressed ones under Embeded/fonts
+        filter "options:heimgui-raw-fonts"
+            defines { "HE_IMGUI_RAW_FONTS" }
+            prebuildcommands { "\"" .. heimguiPython .. "\" \"%{prj.location}/Scripts/embed_raw_fonts.py\" \"%{prj.location}/Source/HEImGui/Embeded/fonts\"" }
+        filter {}
+
+        -- icon fonts are subset to the application's manifest, their glyph ranges generated to match
+        if _OPTIONS["heimgui-icon-manifest"] then
+            defines { "HE_IMGUI_ICON_SUBSET" }
+            prebuildcommands { "\"" .. heimguiPython .. "\" \"%{prj.location}/Scripts/subset_icon_fonts.py\" \"" .. path.getabsolute(_OPTIONS["heimgui-icon-manifest"]) .. "\" \"%{prj.location}/Source/HEImGui/Embeded/fonts\"" }
+        end
+
         SetupShaders(
             { D3D11 = true, D3D12 = true, VULKAN = true },  -- api
             "%{prj.location}/Source/Shaders",               -- sourceDir